@@ -0,0 +1,172 @@
+#include "puzzlebatchgenerator.h"
+#include "maskrasterizerbenchmark.h"
+#include "edgelookupbenchmark.h"
+#include "maskkernelcheck.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QTextStream>
+#include <QThread>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("MyPuzzleCreatorBatch");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Generates puzzle previews and pieces for images without a GUI.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("images", "Image files or directories of images.", "<image|directory>...");
+
+    QCommandLineOption rowsOption({"r", "rows"}, "Number of puzzle rows.", "rows");
+    QCommandLineOption columnsOption({"c", "columns"}, "Number of puzzle columns.", "columns");
+    QCommandLineOption seedOption({"s", "seed"}, "Seed of the edge shapes.", "seed", "0");
+    QCommandLineOption outputOption({"o", "output"}, "Output directory, one subdirectory per image.", "directory", ".");
+    QCommandLineOption jobsOption({"j", "jobs"}, "Number of images generated at the same time.", "jobs",
+                                  QString::number(qMax(1, QThread::idealThreadCount())));
+    QCommandLineOption threadsOption({"t", "threads"}, "Cutting threads per image, 0 shares all cores.", "threads", "0");
+    QCommandLineOption layoutOption("layout", "Piece layout: rectangular, hexagonal or irregular.", "layout", "rectangular");
+    QCommandLineOption engineOption("engine", "Cutting engine: per-piece or single-pass.", "engine", "per-piece");
+    QCommandLineOption maskCacheOption("mask-cache", "Reuse piece masks between images with the same size.");
+    QCommandLineOption tiledOption("tiled", "Cut every image in tiles read from its file, large images always are.");
+    QCommandLineOption tileSizeOption("tile-size", "Edge length of the tiles in pixels.", "pixels", "4096");
+    QCommandLineOption packOption("pack", "Write the pieces as one pieces.mpcpack file instead of PNG files.");
+    QCommandLineOption rasterizerOption("rasterizer", "Piece mask rasterizer: painter (aliased) or scanline (anti-aliased).",
+                                        "rasterizer", "painter");
+    QCommandLineOption toleranceOption("tolerance", "Largest distance in pixels between a piece outline and the polygon the scanline "
+                                       "rasterizer fills.", "pixels", "0.2");
+    QCommandLineOption benchmarkMasksOption("benchmark-masks", "Compare the mask rasterizers on a blank image of the given size "
+                                            "instead of generating images.", "widthxheight");
+    QCommandLineOption benchmarkEdgesOption("benchmark-edges", "Time the edge lookups of a rectangular puzzle with at least the given "
+                                            "number of edges, such as 10000, instead of generating images.", "edges");
+    QCommandLineOption checkMaskKernelOption("check-mask-kernel", "Compare the pieces cut by every mask kernel with the pieces cut by "
+                                             "QPainter on a random image of the given size instead of generating images.", "widthxheight");
+    parser.addOptions({rowsOption, columnsOption, seedOption, outputOption, jobsOption, threadsOption, layoutOption, engineOption, maskCacheOption,
+                       tiledOption, tileSizeOption, packOption, rasterizerOption, toleranceOption, benchmarkMasksOption,
+                       benchmarkEdgesOption, checkMaskKernelOption});
+
+    parser.process(a);
+
+    QTextStream errorStream(stderr);
+    bool rowsValid = false;
+    bool columnsValid = false;
+    int rows = parser.value(rowsOption).toInt(&rowsValid);
+    int columns = parser.value(columnsOption).toInt(&columnsValid);
+    if (!parser.isSet(benchmarkEdgesOption) && (!rowsValid || !columnsValid || rows < 2 || columns < 2))
+    {
+        errorStream << "--rows and --columns must both be given and at least 2" << Qt::endl;
+        return 1;
+    }
+
+    const QHash<QString, PuzzleGenerationSettings::LayoutType> layoutTypes = {
+        {"rectangular", PuzzleGenerationSettings::RectangularLayout},
+        {"hexagonal", PuzzleGenerationSettings::HexagonalLayout},
+        {"irregular", PuzzleGenerationSettings::IrregularLayout}
+    };
+    QString layout = parser.value(layoutOption);
+    if (!layoutTypes.contains(layout))
+    {
+        errorStream << "unknown piece layout " << layout << Qt::endl;
+        return 1;
+    }
+
+    QString engine = parser.value(engineOption);
+    if (engine != "per-piece" && engine != "single-pass")
+    {
+        errorStream << "unknown cutting engine " << engine << Qt::endl;
+        return 1;
+    }
+
+    QString rasterizer = parser.value(rasterizerOption);
+    if (rasterizer != "painter" && rasterizer != "scanline")
+    {
+        errorStream << "unknown mask rasterizer " << rasterizer << Qt::endl;
+        return 1;
+    }
+
+    PuzzleGenerationSettings settings;
+    settings.seed = parser.value(seedOption).toUInt();
+    settings.threadCount = qMax(0, parser.value(threadsOption).toInt());
+    settings.layoutType = layoutTypes.value(layout);
+    settings.cuttingEngine = engine == "single-pass" ? PuzzleGenerationSettings::LabelMap : PuzzleGenerationSettings::PerShape;
+    settings.maskRasterizer = rasterizer == "scanline" ? PuzzleGenerationSettings::ScanlineMask : PuzzleGenerationSettings::PainterMask;
+    settings.useMaskCache = parser.isSet(maskCacheOption);
+    settings.tileSize = qMax(256, parser.value(tileSizeOption).toInt());
+    settings.flatteningTolerance = qMax(0.01, parser.value(toleranceOption).toDouble());
+
+    if (parser.isSet(benchmarkEdgesOption))
+    {
+        int edgeCount = parser.value(benchmarkEdgesOption).toInt();
+        if (edgeCount < 12)
+        {
+            errorStream << "--benchmark-edges needs at least 12 edges, the edges of a 2x2 puzzle" << Qt::endl;
+            return 1;
+        }
+
+        QTextStream outputStream(stdout);
+        return EdgeLookupBenchmark::run(edgeCount, settings, outputStream) ? 0 : 2;
+    }
+
+    auto imageSizeValue = [&parser](const QCommandLineOption& option)
+    {
+        QStringList sizeParts = parser.value(option).split('x');
+        return sizeParts.count() == 2 ? QSize(sizeParts[0].toInt(), sizeParts[1].toInt()) : QSize();
+    };
+
+    if (parser.isSet(benchmarkMasksOption))
+    {
+        QSize imageSize = imageSizeValue(benchmarkMasksOption);
+        if (imageSize.width() < columns || imageSize.height() < rows)
+        {
+            errorStream << "--benchmark-masks needs a size like 4000x3000 with at least one pixel per piece" << Qt::endl;
+            return 1;
+        }
+
+        QTextStream outputStream(stdout);
+        return MaskRasterizerBenchmark::run(rows, columns, imageSize, settings, outputStream) ? 0 : 2;
+    }
+
+    if (parser.isSet(checkMaskKernelOption))
+    {
+        QSize imageSize = imageSizeValue(checkMaskKernelOption);
+        if (imageSize.width() < columns || imageSize.height() < rows)
+        {
+            errorStream << "--check-mask-kernel needs a size like 2000x1500 with at least one pixel per piece" << Qt::endl;
+            return 1;
+        }
+
+        QTextStream outputStream(stdout);
+        return MaskKernelCheck::run(rows, columns, imageSize, settings, outputStream) ? 0 : 2;
+    }
+
+    QStringList imageFiles = PuzzleBatchGenerator::collectImageFiles(parser.positionalArguments());
+    if (imageFiles.isEmpty())
+    {
+        parser.showHelp(1);
+    }
+
+    PuzzleBatchGenerator generator(rows, columns, settings, parser.value(outputOption));
+    generator.setConcurrentImages(parser.value(jobsOption).toInt());
+    generator.setForceTiled(parser.isSet(tiledOption));
+    generator.setWritePiecePack(parser.isSet(packOption));
+
+    QElapsedTimer timer;
+    timer.start();
+    const QList<PuzzleBatchGenerator::ImageResult> results = generator.run(imageFiles);
+
+    int failedImages = 0;
+    for (const PuzzleBatchGenerator::ImageResult &result : results)
+    {
+        if (!result.succeeded)
+        {
+            failedImages++;
+        }
+    }
+
+    QTextStream(stdout) << results.count() - failedImages << " of " << results.count() << " images done in "
+                        << timer.elapsed() << " ms" << Qt::endl;
+
+    return failedImages == 0 ? 0 : 2;
+}
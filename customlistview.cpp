@@ -2,18 +2,28 @@
 #include <QDragEnterEvent>
 #include <QDragMoveEvent>
 #include <QDropEvent>
-#include <QStandardItem>
 #include <QDrag>
 #include <QCoreApplication>
 #include <QMimeData>
-#include <QDebug>
 
 
 /**
  * @class CustomListView
  * @brief Subclass of QListView providing custom drag-and-drop functionality.
+ *
+ * Dragged items carry their piece id only, receivers look the piece up in the shared PuzzlePieceStore.
  */
 
+/**
+     * @brief Sets the store the pixmaps shown while dragging are taken from.
+     *
+     * @param store The piece store, or a null pointer.
+     */
+void CustomListView::setPieceStore(const QSharedPointer<PuzzlePieceStore> &store)
+{
+    pieceStore = store;
+}
+
 /**
      * @brief Event handler for drag enter events.
      *
@@ -62,7 +72,9 @@ void CustomListView::dropEvent(QDropEvent *event)
 /**
  * @brief Event handler for mouse press events.
  *
- * Creates a drag object with custom mime data
+ * Creates a drag object carrying the piece id of the pressed item. The drag shows the cached
+ * thumbnail at the icon size, so no full size copy of the piece is made, and the grab offset is
+ * scaled to full piece coordinates for the receiver.
  *
  * @param event The mouse press event.
  */
@@ -72,23 +84,27 @@ void CustomListView::mousePressEvent(QMouseEvent *event)
         QModelIndex index = indexAt(event->position().toPoint());
         if (index.isValid())
         {
-            QStandardItem *item = qobject_cast<QStandardItemModel*>(this->model())->itemFromIndex(index);
-            QPixmap pixmap = item->icon().pixmap(this->iconSize());
-            QString name = item->text();
-            QPoint offset = event->position().toPoint() - visualRect(index).topLeft();
+            int pieceId = index.data(PuzzlePieceAtlas::PieceIdRole).toInt();
+            QSize pieceSize = pieceStore ? pieceStore->pieceSize(pieceId) : QSize();
+            QSize dragSize = pieceSize.scaled(iconSize(), Qt::KeepAspectRatio).boundedTo(pieceSize);
+            QPixmap pixmap = pieceStore ? pieceStore->thumbnail(pieceId, dragSize) : QPixmap();
+            if (!pixmap.isNull() && pixmap.size() != dragSize)
+            {
+                pixmap = pixmap.scaled(dragSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+            }
+
+            QPoint hotSpot = event->position().toPoint() - visualRect(index).topLeft();
+            hotSpot = QPoint(qBound(0, hotSpot.x(), qMax(0, dragSize.width() - 1)), qBound(0, hotSpot.y(), qMax(0, dragSize.height() - 1)));
+            QPoint offset = dragSize.isEmpty() ? hotSpot : QPoint(hotSpot.x() * pieceSize.width() / dragSize.width(),
+                                                                  hotSpot.y() * pieceSize.height() / dragSize.height());
 
             QDrag *drag = new QDrag(this);
             QMimeData *mimeData = new QMimeData;
 
-            QByteArray encodedData;
-            QDataStream stream(&encodedData, QIODevice::WriteOnly);
-            stream << pixmap << name <<  QPoint(offset);
-
-
-            mimeData->setData("application/x-custom-listView-data", encodedData);
+            mimeData->setData("application/x-custom-listView-data", PuzzlePieceStore::encodePiece(pieceId, offset));
             drag->setMimeData(mimeData);
             drag->setPixmap(pixmap);
-            drag->setHotSpot(offset);
+            drag->setHotSpot(hotSpot);
             drag->exec(Qt::CopyAction);
         }
     }
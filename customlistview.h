@@ -1,6 +1,7 @@
 #ifndef CUSTOMLISTVIEW_H
 #define CUSTOMLISTVIEW_H
 
+#include "puzzlepiecestore.h"
 #include <QListView>
 #include <QObject>
 
@@ -8,6 +9,9 @@ class CustomListView : public QListView
 {
     Q_OBJECT
 
+public:
+    void setPieceStore(const QSharedPointer<PuzzlePieceStore>& store);
+
 signals:
     void itemDragEntered(QDragEnterEvent *event);
     void itemDragMoved(QDragMoveEvent *event);
@@ -20,6 +24,9 @@ protected:
     void dropEvent(QDropEvent *event) override;
     void mousePressEvent(QMouseEvent *event) override;
 
+private:
+    QSharedPointer<PuzzlePieceStore> pieceStore;
+
 };
 
 #endif // CUSTOMLISTVIEW_H
@@ -0,0 +1,140 @@
+#include "edgelookupbenchmark.h"
+#include "puzzleedgedata.h"
+#include "puzzleshapemanager.h"
+#include <QElapsedTimer>
+#include <QHash>
+#include <QPair>
+#include <QRandomGenerator>
+#include <algorithm>
+#include <numeric>
+
+/**
+ * @class EdgeLookupBenchmark
+ * @brief Measures the cost of looking up puzzle edges in PuzzleEdgeData.
+ *
+ * A rectangular puzzle with at least the requested number of edges is generated on a blank image.
+ * Its edges are then looked up the way the pieces are put together, four edges per piece by row
+ * and column, once through the edge ids of PuzzleEdgeData and once through a hash keyed by the
+ * corner points of the edge, as the edges were stored before. Lookups in random id order and the
+ * building of edge paths are timed as well.
+ */
+
+
+namespace
+{
+const int pieceExtent = 40;
+const int lookupRounds = 100;
+
+using EdgeKey = QPair<QPoint, QPoint>;
+
+void reportLookups(QTextStream& output, const QString& name, qint64 elapsed, qint64 lookups)
+{
+    output << name << ": " << elapsed / 1000000.0 << " ms, " << qreal(elapsed) / qMax<qint64>(1, lookups) << " ns per lookup" << Qt::endl;
+}
+}
+
+/**
+ * @brief Generates a rectangular puzzle and reports the time taken by each kind of edge lookup.
+ *
+ * @param edgeCount The least number of edges of the puzzle, border edges included.
+ * @param settings The settings of the puzzle, the seed and the cutting threads are used.
+ * @param output The stream the results are written to.
+ * @return True if the benchmark ran; false if the image could not be allocated.
+ */
+bool EdgeLookupBenchmark::run(int edgeCount, const PuzzleGenerationSettings& settings, QTextStream& output)
+{
+    int gridSize = 2;
+    while (2 * gridSize * (gridSize + 1) < edgeCount)
+    {
+        gridSize++;
+    }
+
+    QImage image(QSize(gridSize, gridSize) * pieceExtent, QImage::Format_ARGB32_Premultiplied);
+    if (image.isNull())
+    {
+        output << "cannot allocate a " << image.width() << "x" << image.height() << " image" << Qt::endl;
+        return false;
+    }
+    image.fill(Qt::white);
+
+    PuzzleGenerationSettings generationSettings = settings;
+    generationSettings.layoutType = PuzzleGenerationSettings::RectangularLayout;
+    generationSettings.useMaskCache = false;
+    generationSettings.useAtlas = false;
+    PuzzleShapeManager manager(gridSize, gridSize, image, generationSettings);
+    manager.generate();
+
+    const PuzzleLayout &layout = manager.puzzleLayout();
+    PuzzleEdgeData edgeData(layout.edgeCount());
+    edgeData.setEdges(manager.puzzleEdges());
+
+    QHash<EdgeKey, PuzzleEdge> edgesByPoints;
+    edgesByPoints.reserve(edgeData.count());
+    for (int edgeId = 0; edgeId < edgeData.count(); ++edgeId)
+    {
+        edgesByPoints.insert(EdgeKey(layout.edge(edgeId).start, layout.edge(edgeId).end), edgeData.getEdge(edgeId));
+    }
+
+    QVector<int> shuffledIds(edgeData.count());
+    std::iota(shuffledIds.begin(), shuffledIds.end(), 0);
+    std::shuffle(shuffledIds.begin(), shuffledIds.end(), QRandomGenerator(settings.seed));
+
+    output << edgeData.count() << " edges, " << gridSize << "x" << gridSize << " pieces, " << lookupRounds << " rounds" << Qt::endl;
+
+    qint64 checksum = 0;
+    qint64 pieceLookups = qint64(lookupRounds) * layout.cellCount() * 4;
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int round = 0; round < lookupRounds; ++round)
+    {
+        for (int row = 0; row < gridSize; ++row)
+        {
+            for (int column = 0; column < gridSize; ++column)
+            {
+                checksum += edgeData.getEdge(PuzzleEdgeData::horizontalEdgeId(row, column, gridSize)).flags;
+                checksum += edgeData.getEdge(PuzzleEdgeData::verticalEdgeId(row, column + 1, gridSize, gridSize)).flags;
+                checksum += edgeData.getEdge(PuzzleEdgeData::horizontalEdgeId(row + 1, column, gridSize)).flags;
+                checksum += edgeData.getEdge(PuzzleEdgeData::verticalEdgeId(row, column, gridSize, gridSize)).flags;
+            }
+        }
+    }
+    reportLookups(output, "grid index", timer.nsecsElapsed(), pieceLookups);
+
+    timer.restart();
+    for (int round = 0; round < lookupRounds; ++round)
+    {
+        for (int pieceId = 0; pieceId < layout.cellCount(); ++pieceId)
+        {
+            const QPolygon &corners = layout.cell(pieceId).polygon;
+            checksum += edgesByPoints.constFind(EdgeKey(corners[0], corners[1]))->flags;
+            checksum += edgesByPoints.constFind(EdgeKey(corners[1], corners[2]))->flags;
+            checksum += edgesByPoints.constFind(EdgeKey(corners[3], corners[2]))->flags;
+            checksum += edgesByPoints.constFind(EdgeKey(corners[0], corners[3]))->flags;
+        }
+    }
+    reportLookups(output, "point pair hash", timer.nsecsElapsed(), pieceLookups);
+
+    timer.restart();
+    for (int round = 0; round < lookupRounds; ++round)
+    {
+        for (int edgeId : std::as_const(shuffledIds))
+        {
+            checksum += edgeData.getEdge(edgeId).flags;
+        }
+    }
+    reportLookups(output, "random id", timer.nsecsElapsed(), qint64(lookupRounds) * shuffledIds.count());
+
+    timer.restart();
+    for (int pieceId = 0; pieceId < layout.cellCount(); ++pieceId)
+    {
+        for (const PuzzleLayout::CellEdge &cellEdge : layout.cell(pieceId).edges)
+        {
+            checksum += edgeData.getEdgePath(cellEdge.edge).elementCount();
+        }
+    }
+    reportLookups(output, "edge path", timer.nsecsElapsed(), qint64(layout.cellCount()) * 4);
+
+    output << "checksum " << checksum << Qt::endl;
+    return true;
+}
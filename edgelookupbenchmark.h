@@ -0,0 +1,13 @@
+#ifndef EDGELOOKUPBENCHMARK_H
+#define EDGELOOKUPBENCHMARK_H
+
+#include "puzzlegenerationsettings.h"
+#include <QTextStream>
+
+class EdgeLookupBenchmark
+{
+public:
+    static bool run(int edgeCount, const PuzzleGenerationSettings& settings, QTextStream& output);
+};
+
+#endif // EDGELOOKUPBENCHMARK_H
@@ -1,7 +1,5 @@
 #include "imagedividerwithbezier.h"
 #include <QPoint>
-#include <QPainter>
-#include <QPainterPath>
 
 /**
  * @class ImageDividerWithBezier
@@ -11,11 +9,14 @@
  */
 
 
-ImageDividerWithBezier::ImageDividerWithBezier(const QImage &image, QObject *parent)
-    : originalImage(image)
-{
-    imageCopy = originalImage;
-}
+/**
+ * @brief Creates a divider.
+ * @param parent The parent object.
+ */
+ImageDividerWithBezier::ImageDividerWithBezier(QObject *parent)
+    : QObject(parent)
+    , edgeRandom(0, 0)
+{}
 
 ImageDividerWithBezier::~ImageDividerWithBezier()
 {
@@ -27,9 +28,12 @@ ImageDividerWithBezier::~ImageDividerWithBezier()
  * @param p1 Edge beggining control point.
  * @param bezierPoints The intermediate points creating lines for bezier modifications.
  * @param p7 Edge ending control point.
+ * @param random The random stream of the edge, continued where the bezier points left it.
  */
-void ImageDividerWithBezier::setBezierPoints(const QPoint &p1, const QVector<QPoint>& bezierPoints, const QPoint &p7)
+void ImageDividerWithBezier::setBezierPoints(const QPoint &p1, const QVector<QPoint>& bezierPoints, const QPoint &p7, const PuzzleEdgeRandom& random)
 {
+    edgeRandom = random;
+
     controlPoint1 = p1;
     controlPoint7 = p7;
 
@@ -42,75 +46,37 @@ void ImageDividerWithBezier::setBezierPoints(const QPoint &p1, const QVector<QPo
 
 /**
  * @brief Prepares the image for cutting based on the bezier control points.
+ * @return The edge, for the caller to store.
  */
-void ImageDividerWithBezier::prepareToCutImage()
-{
-    QPainter painter(&imageCopy);
-
-    QPainterPath bezierPath = createBezierPath();
-    QPair<QPoint, QPoint> edge(controlPoint1, controlPoint7);
-
-    emit saveEdge(edge, bezierPath);
-
-    QPen blackPen(Qt::black);
-    blackPen.setWidth(3);
-    QPen whitePen(Qt::white);
-    whitePen.setWidth(1);
-
-    painter.setRenderHint(QPainter::Antialiasing);
-    painter.setPen(blackPen);
-    painter.drawPath(bezierPath);
-    painter.setPen(whitePen);
-    painter.drawPath(bezierPath);
-
-    painter.end();
-}
-
-/**
- * @brief Saves a preview of the image copy.
- */
-void ImageDividerWithBezier::imageCopyPreview()
+PuzzleEdge ImageDividerWithBezier::prepareToCutImage()
 {
-    QString filePath = "C:/Users/macwe/Pictures/puzzlePreview.jpg";
-    imageCopy.save(filePath);
-    emit loadPreviewImage(imageCopy);
+    return createEdge();
 }
 
 /**
- * @brief Creates the bezier path based on the control points.
- * @return The bezier path.
+ * @brief Creates the edge record based on the control points.
+ *
+ * Border edges never get here, PuzzleShapeManager makes them straight from the layout.
+ *
+ * @return The edge with its tab.
  */
-QPainterPath ImageDividerWithBezier::createBezierPath() const
+PuzzleEdge ImageDividerWithBezier::createEdge() const
 {
-    QPainterPath bezierPath;
-    bezierPath.moveTo(controlPoint1);
-
-    if((controlPoint1.x() == 0 && controlPoint2.x() == 0) ||
-        (controlPoint1.y() == 0 && controlPoint2.y() == 0) ||
-        (controlPoint1.x() == originalImage.width() && controlPoint2.x() == originalImage.width()) ||
-        (controlPoint1.y() == originalImage.height() && controlPoint2.y() == originalImage.height()))
-    {
-        bezierPath.lineTo(controlPoint7);
-    } else
-    {
-
-        QPoint p12 = calculateBezierPointLocationForBaseLine(controlPoint1, controlPoint2, controlPoint3);
-        QPoint p23 = calculateBezierPointLocationForPerpendicularLines(controlPoint2, controlPoint3, controlPoint4);
-        QPoint p34 = calculateBezierPointLocationForLinesBetweenPerpendicularLines(controlPoint3, controlPoint4, controlPoint5);
-        QPoint p45 = calculateBezierPointLocationForLinesBetweenPerpendicularLines(controlPoint5, controlPoint4, controlPoint3);
-        QPoint p56 = calculateBezierPointLocationForPerpendicularLines(controlPoint5, controlPoint6, controlPoint4);
-        QPoint p67 = calculateBezierPointLocationForBaseLine(controlPoint6, controlPoint7, controlPoint5);
-
-
-        bezierPath.quadTo(p12, controlPoint2);
-        bezierPath.quadTo(p23, controlPoint3);
-        bezierPath.quadTo(p34, controlPoint4);
-        bezierPath.quadTo(p45, controlPoint5);
-        bezierPath.quadTo(p56, controlPoint6);
-        bezierPath.quadTo(p67, controlPoint7);
-    }
-
-    return bezierPath;
+    PuzzleEdge edge;
+    edge.flags = PuzzleEdge::Generated;
+    edge.controlPoints[0] = controlPoint1;
+    edge.controlPoints[1] = controlPoint2;
+    edge.controlPoints[2] = controlPoint3;
+    edge.controlPoints[3] = controlPoint4;
+    edge.controlPoints[4] = controlPoint5;
+    edge.controlPoints[5] = controlPoint6;
+    edge.controlPoints[6] = controlPoint7;
+
+    PuzzleEdgeRandom random = edgeRandom;
+    edge.baseLineControlPoints[0] = calculateBezierPointLocationForBaseLine(controlPoint1, controlPoint2, controlPoint3, random);
+    edge.baseLineControlPoints[1] = calculateBezierPointLocationForBaseLine(controlPoint6, controlPoint7, controlPoint5, random);
+
+    return edge;
 }
 
 /**
@@ -118,23 +84,24 @@ QPainterPath ImageDividerWithBezier::createBezierPath() const
  * @param point1 The starting point of the baseline.
  * @param point2 The ending point of the baseline.
  * @param distancePoint The distance point from the baseline.
+ * @param random The random stream of the edge.
  * @return The calculated point for bezier line creation.
  */
-QPoint ImageDividerWithBezier::calculateBezierPointLocationForBaseLine(const QPoint &point1, const QPoint &point2, const QPoint &distancePoint) const
+QPoint ImageDividerWithBezier::calculateBezierPointLocationForBaseLine(const QPoint &point1, const QPoint &point2, const QPoint &distancePoint, PuzzleEdgeRandom &random) const
 {
     QPoint bezierPoint;
     int distance;
-    int isConcave = (rand() % 2) == 0 ? 1 : -1;
+    int isConcave = random.bounded(2) == 0 ? 1 : -1;
 
     if(point1.y() == point2.y())
     {
-        distance = rand() % (qAbs(point2.x() - point1.x()) / 4) + qAbs(point2.x() - point1.x()) / 2;
+        distance = random.bounded(qAbs(point2.x() - point1.x()) / 4) + qAbs(point2.x() - point1.x()) / 2;
 
         bezierPoint.setX(point1.x() + distance);
         bezierPoint.setY(point1.y() - (point1.y() - distancePoint.y()) * isConcave);
     } else if(point1.x() == point2.x())
     {
-        distance = rand() % (qAbs(point2.y() - point1.y()) / 4) + qAbs(point2.y() - point1.y()) / 2;
+        distance = random.bounded(qAbs(point2.y() - point1.y()) / 4) + qAbs(point2.y() - point1.y()) / 2;
 
         bezierPoint.setX(point1.x() - (point1.x() - distancePoint.x()) * isConcave);
         bezierPoint.setY(point1.y() + distance);
@@ -142,59 +109,3 @@ QPoint ImageDividerWithBezier::calculateBezierPointLocationForBaseLine(const QPo
 
     return bezierPoint;
 }
-
-/**
- * @brief Calculates the location of a bezier control points for lines perpendicular to base lines.
- * @param point1 The starting point of the line.
- * @param point2 The ending point of the line.
- * @param distancePoint The distance point from the line.
- * @return The calculated point for bezier line creation.
- */
-QPoint ImageDividerWithBezier::calculateBezierPointLocationForPerpendicularLines(const QPoint &point1, const QPoint &point2, const QPoint &distancePoint) const
-{
-    QPoint bezierPoint;
-    int randomMidPoint;
-
-    if(point1.y() == point2.y())
-    {
-        randomMidPoint = (point2.x() + point1.x()) / 2;
-
-        bezierPoint.setX(randomMidPoint);
-        bezierPoint.setY(point1.y() - (point1.y() - distancePoint.y()));
-    } else if(point1.x() == point2.x())
-    {
-        randomMidPoint = (point2.y() + point1.y()) / 2;
-
-        bezierPoint.setX(point1.x() - (point1.x() - distancePoint.x()));
-        bezierPoint.setY(randomMidPoint);
-    }
-
-    return bezierPoint;
-}
-
-/**
- * @brief Calculates the location of a bezier control point for lines making top part of the "tab"/"notch".
- * @param point1 The starting point of the line.
- * @param point2 The ending point of the line.
- * @param distancePoint The distance point from the line.
- * @return The calculated point for bezier line creation.
- */
-QPoint ImageDividerWithBezier::calculateBezierPointLocationForLinesBetweenPerpendicularLines(const QPoint &point1, const QPoint &point2, const QPoint &distancePoint) const
-{
-    QPoint bezierPoint;
-    int distance;
-
-    if(point1.y() == distancePoint.y())
-    {
-        distance = qAbs(point2.x() - point1.x()) * 0.25;
-        bezierPoint.setX(point1.x()-distance);
-        bezierPoint.setY(point2.y());
-    } else
-    {
-        distance = qAbs(point2.y() - point1.y()) * 0.25;
-        bezierPoint.setX(point2.x());
-        bezierPoint.setY(point1.y()-distance);
-    }
-
-    return bezierPoint;
-}
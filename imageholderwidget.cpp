@@ -1,46 +1,249 @@
 #include "imageholderwidget.h"
 #include <QPainter>
-#include <QStandardItem>
-#include <QListView>
+#include <QPaintEvent>
+#include <QResizeEvent>
+#include <QScreen>
+#include <algorithm>
 
 /**
  * @class ImageHolderWidget
  * @brief The ImageHolderWidget class provides a widget for holding and handling drag-and-drop operations for images (puzzle shapes).
  *
  * This class allows users to drag and drop images onto the widget and handles the positioning of the dropped images.
+ * Placed pieces are not child widgets. The board keeps one record per piece id, finds pieces through a
+ * PuzzleSpatialIndex with buckets about the size of a piece and paints only the pieces overlapping the
+ * repainted area, bottom to top, with one painter. Raising a piece just gives it the next z value, so
+ * neither picking, moving nor raising depend on the number of pieces on the board. Drags carry piece
+ * ids only. Pieces are painted through the shared PuzzlePieceStore, straight from the atlas pages
+ * when there is an atlas, and pieces on the board are recorded in the PuzzlePieceRegistry shared
+ * with the piece pool. Pieces are picked by their shape, using the packed 1-bit mask of their
+ * opaque pixels, so clicking a transparent corner reaches the piece below.
+ *
+ * Once the solution is set, every piece knows where it belongs relative to its layout neighbours.
+ * A piece dropped close to that position next to a neighbour on the board snaps into place and the
+ * two are joined in PuzzlePieceGroups. Grabbing any piece of a group moves and raises the whole group,
+ * and the puzzle is complete when one group holds every piece.
+ *
+ * Drag moves are applied at most once per display frame. Moves arriving in between only replace the
+ * pending position, and every applied move repaints the union of the old and new group bounds.
+ * The painted area per frame is counted in paintStatistics(), which the game dialog shows in its status line.
  */
 
 
-ImageHolderWidget::ImageHolderWidget(QSize& biggestShape, QWidget *parent) : QWidget(parent)
+ImageHolderWidget::ImageHolderWidget(QSize& biggestShape, QWidget *parent)
+    : QWidget(parent)
+    , topZ(0)
+    , draggedPiece(-1)
+    , snapDistance(0)
+    , hasPendingMove(false)
 {
     setAcceptDrops(true);
     setAutoFillBackground(true);
     shapeSize = biggestShape;
+    rebuildIndex();
+
+    moveTimer.setSingleShot(true);
+    moveTimer.setTimerType(Qt::PreciseTimer);
+    connect(&moveTimer, &QTimer::timeout, this, &ImageHolderWidget::flushPendingMove);
+}
+
+/**
+ * @brief Sets the store dropped pieces are drawn from.
+ *
+ * @param store The piece store shared with the piece pool.
+ */
+void ImageHolderWidget::setPieceStore(const QSharedPointer<PuzzlePieceStore>& store)
+{
+    pieceStore = store;
+}
+
+/**
+ * @brief Sets the registry pieces placed on or taken off the board are recorded in.
+ *
+ * @param registry The piece registry shared with the piece pool.
+ */
+void ImageHolderWidget::setPieceRegistry(const QSharedPointer<PuzzlePieceRegistry>& registry)
+{
+    pieceRegistry = registry;
+}
+
+/**
+ * @brief Sets where the pieces belong, enabling snapping and grouping.
+ *
+ * @param layout The layout the pieces were cut from, piece ids are its cell ids.
+ * @param regions The regions the pieces were cut from, keyed by piece id.
+ */
+void ImageHolderWidget::setSolution(const PuzzleLayout& layout, const QHash<int, QRect>& regions)
+{
+    int pieceCount = layout.cellCount();
+    solutionPositions = QVector<QPoint>(pieceCount);
+    pieceNeighbours = QVector<QVector<int>>(pieceCount);
+    for (int pieceId = 0; pieceId < pieceCount; ++pieceId)
+    {
+        solutionPositions[pieceId] = regions.value(pieceId).topLeft();
+        pieceNeighbours[pieceId] = layout.neighbours(pieceId);
+    }
+
+    pieceGroups = PuzzlePieceGroups(pieceCount);
+    QSize spacing = layout.cellSpacing();
+    snapDistance = qMax(4, qMin(spacing.width(), spacing.height()) / 6);
+}
+
+/**
+ * @brief Places a piece on the board, on top of all others.
+ *
+ * A piece that is already on the board is moved instead.
+ *
+ * @param pieceId The piece id.
+ * @param position The top left corner of the piece in widget coordinates.
+ */
+void ImageHolderWidget::addPiece(int pieceId, const QPoint& position)
+{
+    if (pieces.contains(pieceId))
+    {
+        raisePiece(pieceId);
+        movePiece(pieceId, position);
+        return;
+    }
+
+    QSize pieceSize = pieceStore ? pieceStore->pieceSize(pieceId) : QSize();
+    if (!pieceSize.isValid())
+    {
+        return;
+    }
+
+    BoardPiece piece{pieceStore->hitMask(pieceId), QRect(position, pieceSize), ++topZ};
+    pieces.insert(pieceId, piece);
+    pieceIndex.insert(pieceId, piece.rect);
+    if (pieceRegistry)
+    {
+        pieceRegistry->placeOnBoard(pieceId);
+    }
+
+    update(piece.rect);
+}
+
+/**
+ * @brief Takes a piece off the board.
+ *
+ * @param pieceId The piece id.
+ */
+void ImageHolderWidget::removePiece(int pieceId)
+{
+    auto piece = pieces.constFind(pieceId);
+    if (piece == pieces.constEnd())
+    {
+        return;
+    }
+
+    detachPiece(pieceId);
+
+    QRect rect = piece->rect;
+    pieceIndex.remove(pieceId, rect);
+    pieces.erase(piece);
+    if (pieceRegistry && pieceRegistry->location(pieceId) == PuzzlePieceRegistry::Board)
+    {
+        pieceRegistry->remove(pieceId);
+    }
+    if (draggedPiece == pieceId)
+    {
+        draggedPiece = -1;
+    }
+
+    update(rect);
+}
+
+/**
+ * @brief Returns the number of pieces on the board.
+ *
+ * @return The piece count.
+ */
+int ImageHolderWidget::pieceCount() const
+{
+    return pieces.count();
+}
+
+/**
+ * @brief Returns the number of painted frames and pixels since the last reset.
+ *
+ * @return The paint statistics.
+ */
+const ImageHolderWidget::PaintStatistics& ImageHolderWidget::paintStatistics() const
+{
+    return statistics;
+}
+
+/**
+ * @brief Sets the paint statistics back to zero.
+ */
+void ImageHolderWidget::resetPaintStatistics()
+{
+    statistics = PaintStatistics();
+}
+
+/**
+ * @brief Paints the pieces overlapping the repainted area in z order.
+ *
+ * @param event The paint event.
+ */
+void ImageHolderWidget::paintEvent(QPaintEvent *event)
+{
+    quint64 framePixels = 0;
+    for (const QRect &rect : event->region())
+    {
+        framePixels += quint64(rect.width()) * quint64(rect.height());
+    }
+    ++statistics.frames;
+    statistics.paintedPixels += framePixels;
+
+    QVector<int> visiblePieces = pieceIndex.query(event->rect());
+    std::sort(visiblePieces.begin(), visiblePieces.end(), [this](int first, int second)
+    {
+        return pieces[first].z < pieces[second].z;
+    });
+
+    QPainter painter(this);
+    for (int pieceId : std::as_const(visiblePieces))
+    {
+        const BoardPiece &piece = pieces[pieceId];
+        if (event->region().intersects(piece.rect))
+        {
+            pieceStore->drawPiece(&painter, piece.rect, pieceId);
+        }
+    }
+}
+
+/**
+ * @brief Rebuilds the spatial index for the new board size.
+ *
+ * @param event The resize event.
+ */
+void ImageHolderWidget::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    rebuildIndex();
 }
 
 void ImageHolderWidget::mousePressEvent(QMouseEvent *event)
 {
     if (event->button() == Qt::LeftButton)
     {
-        QLabel *label = qobject_cast<QLabel*>(childAt(event->pos()));
-        if (label)
+        int pieceId = pieceAt(event->pos());
+        if (pieceId >= 0)
         {
-            offset = event->pos() - label->pos();
+            raisePiece(pieceId);
+            offset = event->pos() - pieces[pieceId].rect.topLeft();
 
-            myLabel = label;
+            draggedPiece = pieceId;
 
             QDrag *drag = new QDrag(this);
             QMimeData *mimeData = new QMimeData;
 
-            QPixmap pixmap = label->pixmap(Qt::ReturnByValue);
-            QString labelName = label->property("itemName").toString();
-            QByteArray itemData;
-            QDataStream dataStream(&itemData, QIODevice::WriteOnly);
-            dataStream << pixmap << labelName;
-
-            mimeData->setData("application/x-custom-item-data", itemData);
+            mimeData->setData("application/x-custom-item-data", PuzzlePieceStore::encodePiece(pieceId, offset));
             drag->setMimeData(mimeData);
             drag->exec(Qt::CopyAction);
+            cancelPendingMove();
+            draggedPiece = -1;
         }
     }
 }
@@ -51,64 +254,341 @@ void ImageHolderWidget::dragEnterEvent(QDragEnterEvent *event)
 }
 
 
+/**
+ * @brief Follows a piece dragged over the board, applying at most one move per frame.
+ *
+ * @param event The drag move event.
+ */
 void ImageHolderWidget::dragMoveEvent(QDragMoveEvent *event)
 {
-    if (event->mimeData()->hasFormat("application/x-custom-item-data"))
+    if (event->mimeData()->hasFormat("application/x-custom-item-data") && draggedPiece >= 0)
     {
-        QPoint newPos = event->position().toPoint() - offset;
-        myLabel->move(newPos);
+        pendingMovePosition = event->position().toPoint() - offset;
+        hasPendingMove = true;
+        if (!moveTimer.isActive())
+        {
+            flushPendingMove();
+        }
     }
     event->accept();
 }
 
+/**
+ * @brief Applies the last move received while the dragged piece leaves the board.
+ *
+ * @param event The drag leave event.
+ */
 void ImageHolderWidget::dragLeaveEvent(QDragLeaveEvent *event)
-{}
+{
+    Q_UNUSED(event);
+    flushPendingMove();
+}
 
 void ImageHolderWidget::dropEvent(QDropEvent *event)
 {
     QPoint dropPos = event->position().toPoint();
+    int pieceId = -1;
+    QPoint grabOffset;
 
-    if (event->mimeData()->hasFormat("application/x-custom-listView-data"))
+    if (PuzzlePieceStore::decodePiece(event->mimeData(), "application/x-custom-listView-data", &pieceId, &grabOffset))
+    {
+        if (!pieces.contains(pieceId) && pieceStore && pieceStore->contains(pieceId))
+        {
+            emit pieceDropped(pieceId);
+            addPiece(pieceId, dropPos - grabOffset);
+            snapPiece(pieceId);
+        }
+    }else if(PuzzlePieceStore::decodePiece(event->mimeData(), "application/x-custom-item-data", &pieceId, &grabOffset))
     {
-        QByteArray itemData = event->mimeData()->data("application/x-custom-listView-data");
-        QDataStream dataStream(&itemData, QIODevice::ReadOnly);
-        QPixmap pixmap;
-        QString labelName;
-        QPoint offset;
-        dataStream >> pixmap >> labelName >> offset;
+        if (pieces.contains(pieceId))
+        {
+            cancelPendingMove();
+            movePiece(pieceId, dropPos - grabOffset);
+            snapPiece(pieceId);
+            event->acceptProposedAction();
+            return;
+        }
 
-        if (!pixmap.isNull())
+        emit pieceDropped(pieceId);
+        addPiece(pieceId, dropPos - grabOffset);
+        snapPiece(pieceId);
+    }
+
+    event->acceptProposedAction();
+}
+
+/**
+ * @brief Finds the topmost piece whose shape covers a position.
+ *
+ * @param position The position in widget coordinates.
+ * @return The id of the piece, or -1 if there is none.
+ */
+int ImageHolderWidget::pieceAt(const QPoint& position) const
+{
+    int topmost = -1;
+    quint64 topmostZ = 0;
+    const QVector<int> candidates = pieceIndex.query(position);
+    for (int pieceId : candidates)
+    {
+        const BoardPiece &piece = *pieces.constFind(pieceId);
+        if ((topmost < 0 || piece.z > topmostZ) && hitsPiece(piece, position))
         {
-            QLabel *label = new QLabel(this);
-            label->setPixmap(pixmap);
+            topmost = pieceId;
+            topmostZ = piece.z;
+        }
+    }
+
+    return topmost;
+}
+
+/**
+ * @brief Checks whether a position lies on an opaque pixel of a piece.
+ *
+ * @param piece The piece.
+ * @param position The position in widget coordinates.
+ * @return True if the piece mask is set at the position; otherwise, false.
+ */
+bool ImageHolderWidget::hitsPiece(const BoardPiece& piece, const QPoint& position)
+{
+    if (!piece.rect.contains(position))
+    {
+        return false;
+    }
+
+    const QImage &mask = piece.hitMask;
+    int x = (position.x() - piece.rect.left()) * mask.width() / piece.rect.width();
+    int y = (position.y() - piece.rect.top()) * mask.height() / piece.rect.height();
+    if (x < 0 || y < 0 || x >= mask.width() || y >= mask.height())
+    {
+        return false;
+    }
+
+    return mask.constScanLine(y)[x >> 3] & (1 << (x & 7));
+}
+
+/**
+ * @brief Returns the pieces that move together with a piece.
+ *
+ * @param pieceId The piece id.
+ * @return The members of the group of the piece, or just the piece without a solution.
+ */
+QVector<int> ImageHolderWidget::pieceGroup(int pieceId) const
+{
+    if (pieceId < pieceGroups.pieceCount())
+    {
+        return pieceGroups.members(pieceId);
+    }
+
+    return {pieceId};
+}
+
+/**
+ * @brief Checks whether two pieces on the board lie exactly as they do in the solved puzzle.
+ *
+ * @param firstPiece The first piece id.
+ * @param secondPiece The second piece id.
+ * @return True if the offset between the pieces matches the solution; otherwise, false.
+ */
+bool ImageHolderWidget::isSolutionAligned(int firstPiece, int secondPiece) const
+{
+    auto first = pieces.constFind(firstPiece);
+    auto second = pieces.constFind(secondPiece);
+    if (first == pieces.constEnd() || second == pieces.constEnd())
+    {
+        return false;
+    }
+
+    return second->rect.topLeft() - first->rect.topLeft() == solutionPositions[secondPiece] - solutionPositions[firstPiece];
+}
+
+/**
+ * @brief Moves a piece together with its group and repaints the union of their old and new bounds.
+ *
+ * @param pieceId The piece id.
+ * @param position The new top left corner of the piece.
+ */
+void ImageHolderWidget::movePiece(int pieceId, const QPoint& position)
+{
+    QPoint delta = position - pieces[pieceId].rect.topLeft();
+    if (delta.isNull())
+    {
+        return;
+    }
+
+    QRect oldBounds;
+    QRect newBounds;
+    const QVector<int> group = pieceGroup(pieceId);
+    for (int member : group)
+    {
+        BoardPiece &piece = pieces[member];
+        oldBounds |= piece.rect;
+        pieceIndex.remove(member, piece.rect);
+        piece.rect.translate(delta);
+        pieceIndex.insert(member, piece.rect);
+        newBounds |= piece.rect;
+    }
+
+    update(oldBounds | newBounds);
+}
 
-            emit handleDropEvent(label, labelName, dropPos-offset);
+/**
+ * @brief Puts a piece and its group on top of all others.
+ *
+ * @param pieceId The piece id.
+ */
+void ImageHolderWidget::raisePiece(int pieceId)
+{
+    const QVector<int> group = pieceGroup(pieceId);
+    if (group.count() == 1 && pieces[pieceId].z == topZ)
+    {
+        return;
+    }
+
+    QRect bounds;
+    for (int member : group)
+    {
+        BoardPiece &piece = pieces[member];
+        piece.z = ++topZ;
+        bounds |= piece.rect;
+    }
+
+    update(bounds);
+}
+
+/**
+ * @brief Snaps a dropped piece and its group to neighbours lying close to their solution offset.
+ *
+ * The group is moved once, by the smallest correction to any close neighbour, and then joined with
+ * every neighbour that lines up after the move. Only the layout neighbours of the group members are
+ * looked at, so the cost depends on the group and not on the number of pieces on the board.
+ * Emits puzzleCompleted() once every piece is joined.
+ *
+ * @param pieceId The id of the dropped piece.
+ */
+void ImageHolderWidget::snapPiece(int pieceId)
+{
+    if (pieceId >= pieceGroups.pieceCount())
+    {
+        return;
+    }
+
+    bool canSnap = false;
+    QPoint snapCorrection;
+    const QVector<int> group = pieceGroups.members(pieceId);
+    for (int member : group)
+    {
+        for (int neighbour : std::as_const(pieceNeighbours[member]))
+        {
+            auto neighbourPiece = pieces.constFind(neighbour);
+            if (neighbourPiece == pieces.constEnd() || pieceGroups.connected(member, neighbour))
+            {
+                continue;
+            }
+
+            QPoint target = neighbourPiece->rect.topLeft() + solutionPositions[member] - solutionPositions[neighbour];
+            QPoint correction = target - pieces[member].rect.topLeft();
+            if (correction.manhattanLength() <= snapDistance
+                && (!canSnap || correction.manhattanLength() < snapCorrection.manhattanLength()))
+            {
+                snapCorrection = correction;
+                canSnap = true;
+            }
         }
-    }else if(event->mimeData()->hasFormat("application/x-custom-item-data"))
+    }
+
+    if (!canSnap)
     {
-        QByteArray itemData = event->mimeData()->data("application/x-custom-item-data");
-        QDataStream dataStream(&itemData, QIODevice::ReadOnly);
-        QPixmap pixmap;
-        QString labelName;
-        dataStream >> pixmap >> labelName;
+        return;
+    }
 
-        foreach (QObject *child, children())
+    movePiece(pieceId, pieces[pieceId].rect.topLeft() + snapCorrection);
+
+    bool joined = false;
+    for (int member : group)
+    {
+        for (int neighbour : std::as_const(pieceNeighbours[member]))
         {
-            QLabel *existingLabel = qobject_cast<QLabel*>(child);
-            if (existingLabel && existingLabel->property("itemName").toString() == labelName)
+            if (!pieceGroups.connected(member, neighbour) && isSolutionAligned(member, neighbour))
             {
-                existingLabel->move(dropPos - offset);
-                event->acceptProposedAction();
-                this->update();
-                return;
+                pieceGroups.unite(member, neighbour);
+                joined = true;
             }
         }
+    }
 
-        QLabel *label = new QLabel(this);
-        label->setPixmap(pixmap);
+    if (joined && pieceGroups.largestGroupSize() == pieceGroups.pieceCount())
+    {
+        emit puzzleCompleted();
+    }
+}
 
-        emit handleDropEvent(label, labelName, dropPos);
-    }    
+/**
+ * @brief Takes a piece out of its group before it leaves the board.
+ *
+ * The group is broken up and the remaining members that still touch in solution position are joined again.
+ *
+ * @param pieceId The piece id.
+ */
+void ImageHolderWidget::detachPiece(int pieceId)
+{
+    if (pieceId >= pieceGroups.pieceCount() || pieceGroups.groupSize(pieceId) == 1)
+    {
+        return;
+    }
 
-    event->acceptProposedAction();
+    const QVector<int> formerMembers = pieceGroups.split(pieceId);
+    for (int member : formerMembers)
+    {
+        if (member == pieceId)
+        {
+            continue;
+        }
+
+        for (int neighbour : std::as_const(pieceNeighbours[member]))
+        {
+            if (neighbour != pieceId && isSolutionAligned(member, neighbour))
+            {
+                pieceGroups.unite(member, neighbour);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Recreates the spatial index over the board area and inserts every piece again.
+ */
+void ImageHolderWidget::rebuildIndex()
+{
+    pieceIndex = PuzzleSpatialIndex(rect(), qMax(32, qMax(shapeSize.width(), shapeSize.height())));
+    for (auto it = pieces.constBegin(); it != pieces.constEnd(); ++it)
+    {
+        pieceIndex.insert(it.key(), it->rect);
+    }
+}
+
+/**
+ * @brief Applies the pending drag move and waits a frame before applying the next one.
+ */
+void ImageHolderWidget::flushPendingMove()
+{
+    if (!hasPendingMove || !pieces.contains(draggedPiece))
+    {
+        hasPendingMove = false;
+        return;
+    }
+
+    hasPendingMove = false;
+    movePiece(draggedPiece, pendingMovePosition);
+
+    qreal refreshRate = screen() ? screen()->refreshRate() : 60.0;
+    moveTimer.start(qMax(1, qRound(1000.0 / qMax(1.0, refreshRate))));
+}
+
+/**
+ * @brief Drops the pending drag move, the drag ended and the piece is placed directly.
+ */
+void ImageHolderWidget::cancelPendingMove()
+{
+    moveTimer.stop();
+    hasPendingMove = false;
 }
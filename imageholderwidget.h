@@ -1,6 +1,11 @@
 #ifndef IMAGEHOLDERWIDGET_H
 #define IMAGEHOLDERWIDGET_H
 
+#include "puzzlelayout.h"
+#include "puzzlepiecegroups.h"
+#include "puzzlepieceregistry.h"
+#include "puzzlepiecestore.h"
+#include "puzzlespatialindex.h"
 #include <QWidget>
 #include <QMimeData>
 #include <QMouseEvent>
@@ -8,15 +13,34 @@
 #include <QDragEnterEvent>
 #include <QDragMoveEvent>
 #include <QDropEvent>
-#include <QLabel>
+#include <QHash>
+#include <QPixmap>
+#include <QTimer>
 
 class ImageHolderWidget : public QWidget {
     Q_OBJECT
 
 public:
+    struct PaintStatistics
+    {
+        quint64 frames = 0;
+        quint64 paintedPixels = 0;
+    };
+
     explicit ImageHolderWidget(QSize& biggestShape, QWidget *parent = nullptr);
 
+    void setPieceStore(const QSharedPointer<PuzzlePieceStore>& store);
+    void setPieceRegistry(const QSharedPointer<PuzzlePieceRegistry>& registry);
+    void setSolution(const PuzzleLayout& layout, const QHash<int, QRect>& regions);
+    void addPiece(int pieceId, const QPoint& position);
+    void removePiece(int pieceId);
+    int pieceCount() const;
+    const PaintStatistics& paintStatistics() const;
+    void resetPaintStatistics();
+
 protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
     void mousePressEvent(QMouseEvent *event) override;
     void dragEnterEvent(QDragEnterEvent *event) override;
     void dragMoveEvent(QDragMoveEvent *event) override;
@@ -24,15 +48,48 @@ protected:
     void dropEvent(QDropEvent *event) override;
 
 private:
+    struct BoardPiece
+    {
+        QImage hitMask;
+        QRect rect;
+        quint64 z;
+    };
+
+    int pieceAt(const QPoint& position) const;
+    static bool hitsPiece(const BoardPiece& piece, const QPoint& position);
+    QVector<int> pieceGroup(int pieceId) const;
+    bool isSolutionAligned(int firstPiece, int secondPiece) const;
+    void movePiece(int pieceId, const QPoint& position);
+    void raisePiece(int pieceId);
+    void snapPiece(int pieceId);
+    void detachPiece(int pieceId);
+    void flushPendingMove();
+    void cancelPendingMove();
+    void rebuildIndex();
+
     QSize shapeSize;
     QPoint offset;
 
-    QLabel* myLabel;
-    QPoint labelPickUpOffset;
+    QSharedPointer<PuzzlePieceStore> pieceStore;
+    QSharedPointer<PuzzlePieceRegistry> pieceRegistry;
+    QHash<int, BoardPiece> pieces;
+    PuzzleSpatialIndex pieceIndex;
+    quint64 topZ;
+    int draggedPiece;
+
+    QVector<QPoint> solutionPositions;
+    QVector<QVector<int>> pieceNeighbours;
+    PuzzlePieceGroups pieceGroups;
+    int snapDistance;
+
+    QTimer moveTimer;
+    QPoint pendingMovePosition;
+    bool hasPendingMove;
+    PaintStatistics statistics;
 
 signals:
-    void handleDropEvent(QLabel* newImage, QString fileName, QPoint dropPos);
-    void moveLabel(QLabel* moveImage, QPoint dropPos);
+    void pieceDropped(int pieceId);
+    void puzzleCompleted();
 };
 
 #endif // IMAGEHOLDERWIDGET_H
@@ -1,10 +1,13 @@
 #include "itemhidenamedelegate.h"
+#include <QApplication>
+#include <QPainter>
 
 /**
  * @class ItemHideNameDelegate
  * @brief The ItemHideNameDelegate class provides a delegate for hiding item names in views.
  *
  * This class extends QStyledItemDelegate to provide custom painting behavior for item names in views, allowing them to be hidden.
+ * Atlas pieces drawn smaller than half their size are drawn from the nearest thumbnail level of the piece store.
  */
 
 
@@ -25,6 +28,34 @@ void ItemHideNameDelegate::initStyleOption(QStyleOptionViewItem *option, const Q
     {
             option->features &= ~QStyleOptionViewItem::HasDisplay;
     }
+
+    if (hasAtlasPiece(index))
+    {
+        option->features |= QStyleOptionViewItem::HasDecoration;
+    }
+}
+
+/**
+ * @brief Sets the store whose atlas and thumbnails are used to draw items that carry a piece id instead of an icon.
+ *
+ * @param store The piece store, or a null pointer to draw icons only.
+ */
+void ItemHideNameDelegate::setPieceStore(const QSharedPointer<PuzzlePieceStore> &store)
+{
+    pieceStore = store;
+    pieceAtlas = store ? store->atlas() : QSharedPointer<PuzzlePieceAtlas>();
+}
+
+/**
+ * @brief Checks whether the item is drawn from the piece atlas.
+ *
+ * @param index The model index of the item.
+ * @return True if the item has no icon and its piece id is packed in the atlas; otherwise, false.
+ */
+bool ItemHideNameDelegate::hasAtlasPiece(const QModelIndex &index) const
+{
+    return pieceAtlas && !index.data(Qt::DecorationRole).isValid()
+           && pieceAtlas->contains(index.data(PuzzlePieceAtlas::PieceIdRole).toInt());
 }
 
 /**
@@ -39,6 +70,39 @@ void ItemHideNameDelegate::initStyleOption(QStyleOptionViewItem *option, const Q
 void ItemHideNameDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
 {
     QStyleOptionViewItem newOption(option);
-    newOption.text = QString();
-    QStyledItemDelegate::paint(painter, newOption, index);
+    if (!displayRoleEnabled)
+    {
+        newOption.text = QString();
+    }
+
+    if (!hasAtlasPiece(index))
+    {
+        QStyledItemDelegate::paint(painter, newOption, index);
+        return;
+    }
+
+    initStyleOption(&newOption, index);
+    if (!displayRoleEnabled)
+    {
+        newOption.text = QString();
+    }
+
+    const QWidget *widget = newOption.widget;
+    QStyle *style = widget ? widget->style() : QApplication::style();
+    QRect decorationRect = style->subElementRect(QStyle::SE_ItemViewItemDecoration, &newOption, widget);
+    style->drawControl(QStyle::CE_ItemViewItem, &newOption, painter, widget);
+
+    int pieceId = index.data(PuzzlePieceAtlas::PieceIdRole).toInt();
+    QSize pieceSize = pieceAtlas->pieceSize(pieceId).scaled(decorationRect.size(), Qt::KeepAspectRatio);
+    QRect pieceRect(QPoint(), pieceSize);
+    pieceRect.moveCenter(decorationRect.center());
+
+    QPixmap thumbnail = pieceStore->thumbnails()->thumbnail(pieceId, pieceSize);
+    if (!thumbnail.isNull())
+    {
+        painter->drawPixmap(pieceRect, thumbnail);
+        return;
+    }
+
+    pieceAtlas->drawPiece(painter, pieceRect, pieceId);
 }
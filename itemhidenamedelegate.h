@@ -1,6 +1,7 @@
 #ifndef ITEMHIDENAMEDELEGATE_H
 #define ITEMHIDENAMEDELEGATE_H
 
+#include "puzzlepiecestore.h"
 #include <QStyledItemDelegate>
 
 class ItemHideNameDelegate : public QStyledItemDelegate
@@ -10,10 +11,17 @@ public:
 
     bool displayRoleEnabled = false;
 
+    void setPieceStore(const QSharedPointer<PuzzlePieceStore>& store);
+
 protected:
     void initStyleOption(QStyleOptionViewItem *option, const QModelIndex &index) const override;
     void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
 
+private:
+    QSharedPointer<PuzzlePieceStore> pieceStore;
+    QSharedPointer<PuzzlePieceAtlas> pieceAtlas;
+    bool hasAtlasPiece(const QModelIndex &index) const;
+
 };
 
 #endif // ITEMHIDENAMEDELEGATE_H
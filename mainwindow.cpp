@@ -4,6 +4,11 @@
 #include "playpuzzlesshapes.h"
 #include "puzzlesetupsettingsdialog.h"
 #include "puzzleshapemanager.h"
+#include "itemhidenamedelegate.h"
+#include "puzzlepiecepack.h"
+#include "puzzlepiecestore.h"
+#include "puzzlepieceregistry.h"
+#include "puzzlepiecelistmodel.h"
 #include <windows.h>
 #include <QScreen>
 #include <QRect>
@@ -34,7 +39,7 @@
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
-    , imageLabel(new QLabel)
+    , imageLabel(new PuzzlePreviewLabel)
     , scrollArea(new QScrollArea)
 {
     ui->setupUi(this);
@@ -60,7 +65,7 @@ MainWindow::MainWindow(QWidget *parent)
     sizes << width() * 0.75 << width() * 0.25;
     splitter->setSizes(sizes);
 
-    connect(splitter, &QSplitter::splitterMoved, this, &MainWindow::updateListViewItems);
+    connect(imageLabel, &PuzzlePreviewLabel::edgeClicked, this, &MainWindow::rerollEdge);
     createActions();
 
     QScreen *screen = QGuiApplication::primaryScreen();
@@ -76,30 +81,6 @@ MainWindow::~MainWindow()
     delete ui;
 }
 
-/**
- * @brief Handles resizing events for the main window.
- *
- * @param event The resize event.
- */
-void MainWindow::resizeEvent(QResizeEvent *event)
-{
-    QMainWindow::resizeEvent(event);
-    updateListViewItems();
-}
-
-/**
- * @brief Updates the items in the list view.
- */
-void MainWindow::updateListViewItems()
-{
-    QStandardItemModel *model = qobject_cast<QStandardItemModel*>(listView->model());
-    if (model)
-    {
-        listView->setModel(nullptr);
-        listView->setModel(model);
-    }
-}
-
 /**
  * @brief Initializes the image file dialog.
  *
@@ -150,6 +131,22 @@ bool MainWindow::loadFile(const QString &fileName)
 {
     QImageReader reader(fileName);
     reader.setAutoTransform(true);
+
+    QSize sourceSize = reader.size();
+    bool tiled = PuzzleShapeManager::requiresTiledGeneration(sourceSize);
+    if (tiled && !PuzzleShapeManager::supportsTiledGeneration(fileName)) {
+        QMessageBox::information(this, QGuiApplication::applicationDisplayName(),
+                                 tr("Cannot load %1: the image of %2x%3 is too large to decode at once, "
+                                    "and its format cannot be read in tiles")
+                                     .arg(QDir::toNativeSeparators(fileName)).arg(sourceSize.width()).arg(sourceSize.height()));
+        return false;
+    }
+    if (tiled) {
+        const int displayExtent = 4096;
+        reader.setAutoTransform(false);
+        reader.setScaledSize(sourceSize.scaled(displayExtent, displayExtent, Qt::KeepAspectRatio));
+    }
+
     const QImage newImage = reader.read();
     if (newImage.isNull()) {
         QMessageBox::information(this, QGuiApplication::applicationDisplayName(),
@@ -158,7 +155,13 @@ bool MainWindow::loadFile(const QString &fileName)
         return false;
     }
 
+    tiledImageFile = tiled ? fileName : QString();
+    tiledImageSize = tiled ? sourceSize : QSize();
     setImage(newImage);
+    if (tiled) {
+        statusBar()->showMessage(tr("Image of %1x%2 is shown scaled down, pieces are cut from the file in tiles")
+                                     .arg(sourceSize.width()).arg(sourceSize.height()));
+    }
     return true;
 }
 
@@ -173,6 +176,7 @@ void MainWindow::setImage(const QImage &newImage)
     if (image.colorSpace().isValid())
         image.convertToColorSpace(QColorSpace::SRgb);
     imageLabel->setPixmap(QPixmap::fromImage(image));
+    imageLabel->clearEdges();
 
     scaleFactor = 1.0;
 
@@ -278,6 +282,8 @@ void MainWindow::paste()
     if (newImage.isNull()) {
         statusBar()->showMessage(tr("No image in clipboard"));
     } else {
+        tiledImageFile.clear();
+        tiledImageSize = QSize();
         setImage(newImage);
         setWindowFilePath(QString());
         const QString message = tr("Obtained image from clipboard, %1x%2, Depth: %3")
@@ -320,7 +326,8 @@ void MainWindow::preparePuzzleSetUp()
     qreal dpiXMultiplier = image.dotsPerMeterX() * 0.0254 / 100; //image size with inches divided with standard dpi size
     qreal dpiYMultiplier = image.dotsPerMeterY() * 0.0254 / 100;
 
-    QVector<int> imageSize = {static_cast<int>(image.height() / dpiYMultiplier), static_cast<int>(image.width() / dpiXMultiplier)};
+    QSize sourceSize = sourceImageSize();
+    QVector<int> imageSize = {static_cast<int>(sourceSize.height() / dpiYMultiplier), static_cast<int>(sourceSize.width() / dpiXMultiplier)};
     PuzzleSetUpSettingsDialog* dialog = new PuzzleSetUpSettingsDialog(imageSize);
     connect(dialog, &PuzzleSetUpSettingsDialog::acceptPuzzleDimensions, this, &MainWindow::preparePuzzle);
     dialog->open();
@@ -331,107 +338,374 @@ void MainWindow::preparePuzzleSetUp()
  *
  * @param rows Number of rows in the puzzle.
  * @param columns Number of columns in the puzzle.
+ * @param settings Options used while generating and cutting the shapes.
  */
-void MainWindow::preparePuzzle(int rows, int columns)
+void MainWindow::preparePuzzle(int rows, int columns, const PuzzleGenerationSettings& settings)
 {
     this->rows = rows;
     this->columns = columns;
-    QSharedPointer<PuzzleShapeManager> puzzleShapes(new PuzzleShapeManager(rows, columns, image, this));
-    createAction->setEnabled(true);
+    puzzleShapeManager.reset(tiledImageFile.isEmpty()
+                                 ? new PuzzleShapeManager(rows, columns, image, settings)
+                                 : new PuzzleShapeManager(rows, columns, tiledImageFile, settings),
+                             &PuzzleShapeManager::deleteWhenIdle);
+    PuzzleShapeManager *manager = puzzleShapeManager.data();
+    connect(manager, &PuzzleShapeManager::puzzleEdgesReady, this, &MainWindow::receivePuzzleEdges);
+    connect(manager, &PuzzleShapeManager::puzzleEdgeChanged, imageLabel, &PuzzlePreviewLabel::updateEdge);
+    connect(manager, &PuzzleShapeManager::puzzlePiecesChanged, this, &MainWindow::receivePuzzlePieces);
+    // Pieces arrive from a worker thread. A replaced manager is canceled and deleted once its
+    // worker stops, results it had already queued are dropped by checking the current manager.
+    connect(manager, &PuzzleShapeManager::puzzleShapesReady, manager, [this, manager](const QHash<int, QImage> shapes)
+    {
+        if (manager == puzzleShapeManager.data())
+        {
+            receivePuzzleShapes(shapes);
+        }
+    });
+    connect(manager, &PuzzleShapeManager::puzzleAtlasReady, manager, [this, manager](const QSharedPointer<PuzzlePieceAtlas> atlas)
+    {
+        if (manager == puzzleShapeManager.data())
+        {
+            receivePuzzleAtlas(atlas);
+        }
+    });
+    connect(manager, &PuzzleShapeManager::puzzleCuttingFailed, manager, [this, manager](const QString errorString)
+    {
+        if (manager != puzzleShapeManager.data())
+        {
+            return;
+        }
+
+        statusBar()->clearMessage();
+        QMessageBox::information(this, QGuiApplication::applicationDisplayName(), tr("Cannot cut the pieces: %1").arg(errorString));
+    });
+    createAction->setEnabled(false);
+    playAction->setEnabled(false);
+    exportPackAction->setEnabled(false);
+    rerollEdgesAction->setChecked(false);
+    rerollEdgesAction->setEnabled(false);
+    puzzleShapeManager->generateInBackground();
+    statusBar()->showMessage(tr("Cutting %1 pieces...").arg(puzzleShapeManager->puzzleLayout().cellCount()));
+}
+
+/**
+ * @brief Saves the generated puzzle to a piece pack file chosen by the user.
+ */
+void MainWindow::exportPiecePack()
+{
+    if (!puzzleShapeManager)
+    {
+        return;
+    }
+
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Export Piece Pack"), QString(), tr("Piece packs (*.mpcpack)"));
+    if (fileName.isEmpty())
+    {
+        return;
+    }
+
+    QString errorString;
+    if (!puzzleShapeManager->writePiecePack(fileName, &errorString))
+    {
+        QMessageBox::information(this, QGuiApplication::applicationDisplayName(),
+                                 tr("Cannot write %1: %2").arg(QDir::toNativeSeparators(fileName), errorString));
+        return;
+    }
+
+    statusBar()->showMessage(tr("Wrote \"%1\"").arg(QDir::toNativeSeparators(fileName)));
+}
+
+/**
+ * @brief Opens a piece pack file, showing its preview and pieces without cutting them again.
+ */
+void MainWindow::openPiecePack()
+{
+    QString fileName = QFileDialog::getOpenFileName(this, tr("Open Piece Pack"), QString(), tr("Piece packs (*.mpcpack)"));
+    if (fileName.isEmpty())
+    {
+        return;
+    }
+
+    QString errorString;
+    QSharedPointer<PuzzlePiecePack> piecePack = PuzzlePiecePack::open(fileName, &errorString);
+    if (!piecePack)
+    {
+        QMessageBox::information(this, QGuiApplication::applicationDisplayName(),
+                                 tr("Cannot load %1: %2").arg(QDir::toNativeSeparators(fileName), errorString));
+        return;
+    }
+
+    puzzleShapeManager.reset();
+    tiledImageFile.clear();
+    tiledImageSize = QSize();
+    rows = piecePack->layout().rows;
+    columns = piecePack->layout().columns;
+    setImage(piecePack->preview());
+    QHash<int, QImage> images = piecePack->images();
+    receivePuzzleAtlas(PuzzlePieceAtlas::fromPieces(images));
+    pieceImages = images;
     playAction->setEnabled(false);
 }
 
 /**
- * @brief Receives the preview image of the puzzle shapes.
+ * @brief Receives the puzzle edges and shows them as cutting lines over the image.
  *
- * @param imagePreview The preview image of puzzle shapes.
+ * @param edges The puzzle edges in source image coordinates.
  */
-void MainWindow::receivePuzzlePreview(const QImage imagePreview)
+void MainWindow::receivePuzzleEdges(const QVector<PuzzleEdge> edges)
 {
-    setImage(imagePreview);
+    imageLabel->setEdges(edges, sourceImageSize());
 }
 
 /**
  * @brief Receives the puzzle shapes from the puzzle setup dialog.
  *
+ * Shapes arrive as images keyed by piece id and are turned into pixmaps here, on the GUI thread.
+ *
  * @param shapes Hash map of puzzle shapes.
  */
-void MainWindow::receivePuzzleShapes(const QHash<int, QPixmap> shapes)
+void MainWindow::receivePuzzleShapes(const QHash<int, QImage> shapes)
 {
-    int index = 0;
+    pieceAtlas.reset();
+    pieceStore.reset();
+    pieceImages = shapes;
     puzzleShapes.clear();
-    for (int i = 0; i < shapes.count(); ++index)
+    for (auto it = shapes.begin(); it != shapes.end(); ++it)
     {
-        if(!shapes[index].isNull())
-        {
-            puzzleShapes[i] = shapes[index];
-            i++;
-        }
+        puzzleShapes.insert(it.key(), QPixmap::fromImage(it.value()));
     }
 
     foreach (QPixmap shape, puzzleShapes)
     {
-        QSize shapeSize = shape.size();
+        updateBiggestShape(shape.size());
+    }
+
+    finishPuzzleShapes();
+}
+
+/**
+ * @brief Receives the puzzle shapes packed into a shared atlas.
+ *
+ * The piece images the atlas was packed from are kept as well, for building thumbnails off the GUI thread.
+ *
+ * @param atlas The atlas holding every puzzle shape, keyed by piece id.
+ */
+void MainWindow::receivePuzzleAtlas(const QSharedPointer<PuzzlePieceAtlas> atlas)
+{
+    puzzleShapes.clear();
+    pieceStore.reset();
+    pieceImages = puzzleShapeManager ? puzzleShapeManager->shapeImages() : QHash<int, QImage>();
+    pieceAtlas = atlas;
+
+    for (int pieceId : pieceAtlas->pieceIds())
+    {
+        updateBiggestShape(pieceAtlas->pieceSize(pieceId));
+    }
+
+    finishPuzzleShapes();
+}
+
+/**
+ * @brief Receives pieces that were cut again after one of their edges was regenerated.
+ *
+ * Only the given pieces are replaced, in the pixmaps or the atlas, in the piece store and in the list view.
+ *
+ * @param pieces The new piece images keyed by piece id.
+ */
+void MainWindow::receivePuzzlePieces(const QHash<int, QImage> pieces)
+{
+    PuzzlePieceListModel *model = qobject_cast<PuzzlePieceListModel*>(listView->model());
+
+    for (auto it = pieces.begin(); it != pieces.end(); ++it)
+    {
+        QPixmap pixmap;
+        if (pieceAtlas)
+        {
+            pieceAtlas->replacePiece(it.key(), it.value());
+        } else
+        {
+            pixmap = QPixmap::fromImage(it.value());
+            puzzleShapes.insert(it.key(), pixmap);
+        }
+        pieceImages.insert(it.key(), it.value());
+        updateBiggestShape(it.value().size());
 
-        if (shapeSize.width() > biggestShape.width())
+        if (pieceStore)
         {
-            biggestShape.setWidth(shapeSize.width());
+            pieceStore->replacePiece(it.key(), it.value(), pixmap);
         }
 
-        if (shapeSize.height() > biggestShape.height())
+        if (model)
+        {
+            model->refreshPiece(model->row(it.key()));
+        }
+    }
+
+    if (model)
+    {
+        listView->setIconSize(biggestShape);
+        model->setIconSize(biggestShape);
+    }
+}
+
+/**
+ * @brief Regenerates a clicked edge of the prepared puzzle.
+ *
+ * @param edgeId The id of the edge.
+ */
+void MainWindow::rerollEdge(int edgeId)
+{
+    if (!puzzleShapeManager || openGameDialogs > 0)
+    {
+        return;
+    }
+
+    if (!puzzleShapeManager->regenerateEdge(edgeId))
+    {
+        if (!puzzleShapeManager->errorString().isEmpty())
         {
-            biggestShape.setHeight(shapeSize.height());
+            QMessageBox::information(this, QGuiApplication::applicationDisplayName(),
+                                     tr("Cannot regenerate edge %1: %2").arg(edgeId).arg(puzzleShapeManager->errorString()));
         }
+        return;
+    }
+
+    statusBar()->showMessage(tr("Regenerated edge %1").arg(edgeId), 2000);
+}
+
+/**
+ * @brief Enables the actions that need cut pieces once they have arrived.
+ */
+void MainWindow::finishPuzzleShapes()
+{
+    createAction->setEnabled(true);
+    exportPackAction->setEnabled(puzzleShapeManager != nullptr);
+    rerollEdgesAction->setEnabled(puzzleShapeManager != nullptr && openGameDialogs == 0);
+    if (!puzzleShapeManager)
+    {
+        rerollEdgesAction->setChecked(false);
+    }
+    statusBar()->showMessage(tr("Pieces ready"), 2000);
+}
+
+/**
+ * @brief Returns the size of the image the pieces are cut from.
+ *
+ * In tiled mode the shown image is a scaled down copy, while pieces and their regions keep the size of the file.
+ *
+ * @return The full size of the source image.
+ */
+QSize MainWindow::sourceImageSize() const
+{
+    return tiledImageFile.isEmpty() ? image.size() : tiledImageSize;
+}
+
+/**
+ * @brief Grows the biggest shape size so that it fits the given shape.
+ *
+ * @param shapeSize The size of a puzzle shape.
+ */
+void MainWindow::updateBiggestShape(const QSize &shapeSize)
+{
+    if (shapeSize.width() > biggestShape.width())
+    {
+        biggestShape.setWidth(shapeSize.width());
+    }
+
+    if (shapeSize.height() > biggestShape.height())
+    {
+        biggestShape.setHeight(shapeSize.height());
     }
 }
 
 /**
  * @brief Creates the puzzle by populating the list view with puzzle shapes.
+ *
+ * The list shows a PuzzlePieceListModel over the sorted piece ids, icons are taken from the piece store
+ * only for the rows being painted. The thumbnail levels of the pieces are built in the background.
  */
 void MainWindow::createPuzzle()
 {
     listView->setViewMode(QListView::IconMode);
-
+    listView->setMovement(QListView::Static);
+    listView->setResizeMode(QListView::Adjust);
+    listView->setUniformItemSizes(true);
+    listView->setLayoutMode(QListView::Batched);
 
     listView->setIconSize(biggestShape);
 
-    listView->setModel(nullptr);
-    QStandardItemModel* model = new QStandardItemModel();
+    pieceStore.reset(new PuzzlePieceStore(puzzleShapes, pieceAtlas));
+    pieceStore->buildThumbnails(pieceImages);
 
-    QList<int> sortedKeys = puzzleShapes.keys();
-    std::sort(sortedKeys.begin(), sortedKeys.end());
+    ItemHideNameDelegate *delegate = new ItemHideNameDelegate(listView);
+    delegate->displayRoleEnabled = true;
+    delegate->setPieceStore(pieceStore);
+    listView->setItemDelegate(delegate);
 
-    for (int key : sortedKeys)
-    {
-        QPixmap pixmap = puzzleShapes.value(key);
-        QIcon icon(pixmap);
-        QStandardItem* item = new QStandardItem(icon, QString::number(key));
+    QList<int> sortedKeys = pieceAtlas ? pieceAtlas->pieceIds() : puzzleShapes.keys();
+    std::sort(sortedKeys.begin(), sortedKeys.end());
 
-        model->appendRow(item);
-    }
+    QAbstractItemModel *oldModel = listView->model();
+    PuzzlePieceListModel *model = new PuzzlePieceListModel(listView);
+    model->setPieceStore(pieceStore);
+    model->setIconSize(biggestShape);
+    model->setPieceIds(QVector<int>(sortedKeys.begin(), sortedKeys.end()));
 
     listView->setModel(model);
+    delete oldModel;
     playAction->setEnabled(true);
     createAction->setEnabled(false);
 }
 
 /**
  * @brief Plays the puzzle game by opening the puzzle game dialog.
+ *
+ * Rerolling edges is disabled until both play dialogs are closed.
  */
 void MainWindow::playPuzzle()
 {
-    PlayPuzzleGameDialog *playPuzzle = new PlayPuzzleGameDialog(rows, columns, image,biggestShape, this);
+    PlayPuzzleGameDialog *playPuzzle = new PlayPuzzleGameDialog(rows, columns, sourceImageSize(), biggestShape, this);
     playPuzzle->setAttribute(Qt::WA_DeleteOnClose);
-    PlayPuzzlesShapes *playPuzzleShapes = new PlayPuzzlesShapes(qobject_cast<QStandardItemModel*>(listView->model()), biggestShape, this);
+    PuzzlePieceListModel *model = qobject_cast<PuzzlePieceListModel*>(listView->model());
+    PlayPuzzlesShapes *playPuzzleShapes = new PlayPuzzlesShapes(model ? model->pieceIds() : QVector<int>(), biggestShape, this);
     playPuzzleShapes->setAttribute(Qt::WA_DeleteOnClose);
+    QSharedPointer<PuzzlePieceRegistry> pieceRegistry(new PuzzlePieceRegistry);
+    playPuzzle->setPieceStore(pieceStore);
+    playPuzzle->setPieceRegistry(pieceRegistry);
+    playPuzzleShapes->setPieceStore(pieceStore);
+    playPuzzleShapes->setPieceRegistry(pieceRegistry);
+    if (puzzleShapeManager)
+    {
+        playPuzzle->setSolution(puzzleShapeManager->puzzleLayout(), puzzleShapeManager->shapeRegions());
+    }
 
-    connect(playPuzzle, &PlayPuzzleGameDialog::deleteShapeFromPool,playPuzzleShapes,&PlayPuzzlesShapes::deleteItemWithName);
-    connect(playPuzzleShapes, &PlayPuzzlesShapes::dropEventReceived,playPuzzle,&PlayPuzzleGameDialog::deleteLabelWithName);
+    openGameDialogs += 2;
+    rerollEdgesAction->setChecked(false);
+    rerollEdgesAction->setEnabled(false);
+    imageLabel->setEdgePickingEnabled(false);
+    connect(playPuzzle, &QObject::destroyed, this, &MainWindow::closeGameDialog);
+    connect(playPuzzleShapes, &QObject::destroyed, this, &MainWindow::closeGameDialog);
+
+    connect(playPuzzle, &PlayPuzzleGameDialog::deleteShapeFromPool,playPuzzleShapes,&PlayPuzzlesShapes::removePiece);
+    connect(playPuzzleShapes, &PlayPuzzlesShapes::dropEventReceived,playPuzzle,&PlayPuzzleGameDialog::removePiece);
 
     playPuzzleShapes->show();
     playPuzzle->show();
 }
 
+/**
+ * @brief Counts a closed play dialog and allows rerolling edges again once no game is open.
+ *
+ * Pieces on the board and in the pool are not re-cut, so edges can only be rerolled between games.
+ */
+void MainWindow::closeGameDialog()
+{
+    openGameDialogs = qMax(0, openGameDialogs - 1);
+    if (openGameDialogs == 0)
+    {
+        rerollEdgesAction->setEnabled(puzzleShapeManager != nullptr && playAction->isEnabled());
+    }
+}
+
 /**
  * @brief Creates the main window actions for file, edit, view, and puzzle operations.
  */
@@ -451,6 +725,13 @@ void MainWindow::createActions()
 
     fileMenu->addSeparator();
 
+    fileMenu->addAction(tr("Open Piece &Pack..."), this, &MainWindow::openPiecePack);
+
+    exportPackAction = fileMenu->addAction(tr("&Export Piece Pack..."), this, &MainWindow::exportPiecePack);
+    exportPackAction->setEnabled(false);
+
+    fileMenu->addSeparator();
+
     QAction *exitAction = fileMenu->addAction(tr("E&xit"), this, &QWidget::close);
     exitAction->setShortcut(tr("Ctrl+Q"));
 
@@ -477,6 +758,12 @@ void MainWindow::createActions()
     normalSizeAction->setShortcut(tr("Ctrl+N"));
     normalSizeAction->setEnabled(false);
 
+    viewMenu->addSeparator();
+
+    showCutLinesAction = viewMenu->addAction(tr("Show &Cutting Lines"), imageLabel, &PuzzlePreviewLabel::setEdgesVisible);
+    showCutLinesAction->setCheckable(true);
+    showCutLinesAction->setChecked(true);
+
     QMenu *puzzleMenu = menuBar()->addMenu(tr("&Puzzle"));
 
     prepareAction = puzzleMenu->addAction(tr("&Prepare"), this, &MainWindow::preparePuzzleSetUp);
@@ -490,6 +777,12 @@ void MainWindow::createActions()
     playAction = puzzleMenu->addAction(tr("&Play"), this, &MainWindow::playPuzzle);
     playAction->setShortcut(tr("Ctrl+M"));
     playAction->setEnabled(false);
+
+    puzzleMenu->addSeparator();
+
+    rerollEdgesAction = puzzleMenu->addAction(tr("&Reroll Clicked Edges"), imageLabel, &PuzzlePreviewLabel::setEdgePickingEnabled);
+    rerollEdgesAction->setCheckable(true);
+    rerollEdgesAction->setEnabled(false);
 }
 
 /**
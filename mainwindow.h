@@ -1,6 +1,11 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include "puzzlegenerationsettings.h"
+#include "puzzlepieceatlas.h"
+#include "puzzlepiecestore.h"
+#include "puzzleshapemanager.h"
+#include "puzzlepreviewlabel.h"
 #include <QMainWindow>
 #include <QScrollBar>
 #include <QLabel>
@@ -21,13 +26,12 @@ public:
     ~MainWindow();
     bool loadFile(const QString &);
 
-protected:
-    void resizeEvent(QResizeEvent *event) override;
-
 public slots:
-    void preparePuzzle(int row, int column);
-    void receivePuzzlePreview(const QImage imagePreview);
-    void receivePuzzleShapes(const QHash<int, QPixmap> shapes);
+    void preparePuzzle(int row, int column, const PuzzleGenerationSettings& settings);
+    void receivePuzzleEdges(const QVector<PuzzleEdge> edges);
+    void receivePuzzleShapes(const QHash<int, QImage> shapes);
+    void receivePuzzleAtlas(const QSharedPointer<PuzzlePieceAtlas> atlas);
+    void receivePuzzlePieces(const QHash<int, QImage> pieces);
 
 private slots:
     void open();
@@ -43,6 +47,10 @@ private slots:
     void preparePuzzleSetUp();
     void createPuzzle();
     void playPuzzle();
+    void exportPiecePack();
+    void openPiecePack();
+    void rerollEdge(int edgeId);
+    void closeGameDialog();
 
 private:
     Ui::MainWindow *ui;
@@ -57,18 +65,27 @@ private:
     void adjustScrollBar(QScrollBar *scrollBar, double factor);
 
     void openHelpImage();
-    void updateListViewItems();
+    void updateBiggestShape(const QSize &shapeSize);
+    QSize sourceImageSize() const;
+    void finishPuzzleShapes();
 
     QImage image;
-    QLabel *imageLabel;
+    QString tiledImageFile;
+    QSize tiledImageSize;
+    PuzzlePreviewLabel *imageLabel;
     QListView *listView;
     QScrollArea *scrollArea;
     double scaleFactor = 1;
+    QSharedPointer<PuzzleShapeManager> puzzleShapeManager;
     QHash<int, QPixmap> puzzleShapes;
+    QHash<int, QImage> pieceImages;
+    QSharedPointer<PuzzlePieceAtlas> pieceAtlas;
+    QSharedPointer<PuzzlePieceStore> pieceStore;
     QSize biggestShape;
 
     int rows;
     int columns;
+    int openGameDialogs = 0;
 
 #if defined(QT_PRINTSUPPORT_LIB)
     QPrinter printer;
@@ -76,13 +93,16 @@ private:
 
     QAction *saveAsAction;
     QAction *printAction;
+    QAction *exportPackAction;
     QAction *copyAction;
     QAction *zoomInAction;
     QAction *zoomOutAction;
     QAction *normalSizeAction;
+    QAction *showCutLinesAction;
     QAction *prepareAction;
     QAction *createAction;
     QAction *playAction;
+    QAction *rerollEdgesAction;
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,271 @@
+#include "maskapplykernel.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define MASKAPPLY_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define MASKAPPLY_TARGET_SSE41
+#define MASKAPPLY_TARGET_AVX2
+#else
+#define MASKAPPLY_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define MASKAPPLY_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+/**
+ * @class MaskApplyKernel
+ * @brief Vectorized kernel producing premultiplied piece pixels from source scanlines and a coverage mask.
+ *
+ * Every destination pixel is the premultiplied source pixel with all four channels multiplied
+ * by the 8-bit mask value, rounded the same way as the scalar multiplyPixel. The SSE4.1 and AVX2
+ * paths are selected once at runtime from the CPU features, other CPUs use the scalar loop.
+ */
+
+
+namespace
+{
+typedef void (*ApplyMaskFunction)(const QRgb *source, const uchar *mask, QRgb *destination, int count);
+
+/**
+ * @brief Scalar kernel, also used for the tail of the vectorized kernels.
+ */
+void applyMaskScalar(const QRgb *source, const uchar *mask, QRgb *destination, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        uint alpha = mask[i];
+        if (alpha == 0)
+        {
+            destination[i] = 0;
+        } else if (alpha == 255)
+        {
+            destination[i] = source[i];
+        } else
+        {
+            destination[i] = MaskApplyKernel::multiplyPixel(source[i], alpha);
+        }
+    }
+}
+
+#if defined(MASKAPPLY_X86)
+/**
+ * @brief Multiplies eight 16-bit channels by eight 16-bit alphas with multiplyPixel rounding.
+ */
+MASKAPPLY_TARGET_SSE41 inline __m128i multiplyChannels(__m128i channels, __m128i alphas)
+{
+    __m128i product = _mm_mullo_epi16(channels, alphas);
+    product = _mm_add_epi16(product, _mm_srli_epi16(product, 8));
+    product = _mm_add_epi16(product, _mm_set1_epi16(0x80));
+    return _mm_srli_epi16(product, 8);
+}
+
+/**
+ * @brief SSE4.1 kernel, four pixels per iteration.
+ */
+MASKAPPLY_TARGET_SSE41 void applyMaskSse41(const QRgb *source, const uchar *mask, QRgb *destination, int count)
+{
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        quint32 maskBytes;
+        std::memcpy(&maskBytes, mask + i, sizeof(maskBytes));
+
+        if (maskBytes == 0)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), _mm_setzero_si128());
+            continue;
+        }
+
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+        if (maskBytes == 0xffffffffu)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), pixels);
+            continue;
+        }
+
+        __m128i alphas = _mm_cvtsi32_si128(int(maskBytes));
+        alphas = _mm_unpacklo_epi8(alphas, alphas);
+        alphas = _mm_unpacklo_epi16(alphas, alphas);
+
+        __m128i lowPixels = multiplyChannels(_mm_cvtepu8_epi16(pixels), _mm_cvtepu8_epi16(alphas));
+        __m128i highPixels = multiplyChannels(_mm_cvtepu8_epi16(_mm_srli_si128(pixels, 8)), _mm_cvtepu8_epi16(_mm_srli_si128(alphas, 8)));
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), _mm_packus_epi16(lowPixels, highPixels));
+    }
+
+    applyMaskScalar(source + i, mask + i, destination + i, count - i);
+}
+
+/**
+ * @brief Multiplies sixteen 16-bit channels by sixteen 16-bit alphas with multiplyPixel rounding.
+ */
+MASKAPPLY_TARGET_AVX2 inline __m256i multiplyChannels256(__m256i channels, __m256i alphas)
+{
+    __m256i product = _mm256_mullo_epi16(channels, alphas);
+    product = _mm256_add_epi16(product, _mm256_srli_epi16(product, 8));
+    product = _mm256_add_epi16(product, _mm256_set1_epi16(0x80));
+    return _mm256_srli_epi16(product, 8);
+}
+
+/**
+ * @brief AVX2 kernel, eight pixels per iteration.
+ */
+MASKAPPLY_TARGET_AVX2 void applyMaskAvx2(const QRgb *source, const uchar *mask, QRgb *destination, int count)
+{
+    const __m256i zero = _mm256_setzero_si256();
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        quint64 maskBytes;
+        std::memcpy(&maskBytes, mask + i, sizeof(maskBytes));
+
+        if (maskBytes == 0)
+        {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i), zero);
+            continue;
+        }
+
+        __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i));
+        if (maskBytes == ~quint64(0))
+        {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i), pixels);
+            continue;
+        }
+
+        __m128i maskVector = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(mask + i));
+        maskVector = _mm_unpacklo_epi8(maskVector, maskVector);
+        __m256i alphas = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi16(maskVector, maskVector)),
+                                                 _mm_unpackhi_epi16(maskVector, maskVector), 1);
+
+        __m256i lowPixels = multiplyChannels256(_mm256_unpacklo_epi8(pixels, zero), _mm256_unpacklo_epi8(alphas, zero));
+        __m256i highPixels = multiplyChannels256(_mm256_unpackhi_epi8(pixels, zero), _mm256_unpackhi_epi8(alphas, zero));
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i), _mm256_packus_epi16(lowPixels, highPixels));
+    }
+
+    applyMaskScalar(source + i, mask + i, destination + i, count - i);
+}
+
+/**
+ * @brief Detects the best instruction set supported by the CPU and the operating system.
+ */
+MaskApplyKernel::InstructionSet detectInstructionSet()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int maximumLeaf = info[0];
+
+    __cpuid(info, 1);
+    bool hasSse41 = (info[2] & (1 << 19)) != 0;
+    bool hasOsXsave = (info[2] & (1 << 27)) != 0;
+    bool hasAvx = (info[2] & (1 << 28)) != 0;
+
+    bool hasAvx2 = false;
+    if (maximumLeaf >= 7 && hasOsXsave && hasAvx && (_xgetbv(0) & 0x6) == 0x6)
+    {
+        __cpuidex(info, 7, 0);
+        hasAvx2 = (info[1] & (1 << 5)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    bool hasSse41 = __builtin_cpu_supports("sse4.1");
+    bool hasAvx2 = __builtin_cpu_supports("avx2");
+#endif
+
+    if (hasAvx2)
+    {
+        return MaskApplyKernel::Avx2;
+    }
+
+    return hasSse41 ? MaskApplyKernel::Sse41 : MaskApplyKernel::Scalar;
+}
+#endif
+
+/**
+ * @brief Resolves the kernel of an instruction set.
+ */
+ApplyMaskFunction resolveKernel(MaskApplyKernel::InstructionSet instructionSet)
+{
+    switch (instructionSet)
+    {
+#if defined(MASKAPPLY_X86)
+    case MaskApplyKernel::Avx2:
+        return applyMaskAvx2;
+    case MaskApplyKernel::Sse41:
+        return applyMaskSse41;
+#endif
+    default:
+        return applyMaskScalar;
+    }
+}
+}
+
+/**
+ * @brief Returns the instruction set selected for the kernel on this CPU.
+ *
+ * @return The instruction set in use.
+ */
+MaskApplyKernel::InstructionSet MaskApplyKernel::instructionSet()
+{
+#if defined(MASKAPPLY_X86)
+    static const InstructionSet detected = detectInstructionSet();
+    return detected;
+#else
+    return Scalar;
+#endif
+}
+
+/**
+ * @brief Writes count premultiplied pixels, each source pixel multiplied by its mask value.
+ *
+ * @param source The premultiplied ARGB32 source pixels.
+ * @param mask The 8-bit coverage values.
+ * @param destination The premultiplied ARGB32 destination pixels, may not overlap the source.
+ * @param count The number of pixels.
+ */
+void MaskApplyKernel::applyMask(const QRgb *source, const uchar *mask, QRgb *destination, int count)
+{
+    static const ApplyMaskFunction kernel = resolveKernel(instructionSet());
+    kernel(source, mask, destination, count);
+}
+
+/**
+ * @brief Writes count premultiplied pixels with the kernel of the given instruction set.
+ *
+ * Used to compare the kernels with each other, the instruction set must not be above the one
+ * returned by instructionSet().
+ *
+ * @param instructionSet The instruction set of the kernel to run.
+ * @param source The premultiplied ARGB32 source pixels.
+ * @param mask The 8-bit coverage values.
+ * @param destination The premultiplied ARGB32 destination pixels, may not overlap the source.
+ * @param count The number of pixels.
+ */
+void MaskApplyKernel::applyMask(InstructionSet instructionSet, const QRgb *source, const uchar *mask, QRgb *destination, int count)
+{
+    Q_ASSERT(instructionSet <= MaskApplyKernel::instructionSet());
+    resolveKernel(instructionSet)(source, mask, destination, count);
+}
+
+/**
+ * @brief Returns the image in a format the kernel can read directly.
+ *
+ * Format_RGB32 pixels always carry an opaque alpha byte, so they are already valid
+ * premultiplied pixels and are returned without a copy.
+ *
+ * @param image The source image.
+ * @return The image in Format_RGB32 or Format_ARGB32_Premultiplied.
+ */
+QImage MaskApplyKernel::premultipliedSource(const QImage &image)
+{
+    if (image.format() == QImage::Format_RGB32 || image.format() == QImage::Format_ARGB32_Premultiplied)
+    {
+        return image;
+    }
+
+    return image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+}
@@ -0,0 +1,43 @@
+#ifndef MASKAPPLYKERNEL_H
+#define MASKAPPLYKERNEL_H
+
+#include <QImage>
+#include <QRgb>
+
+class MaskApplyKernel
+{
+public:
+    enum InstructionSet
+    {
+        Scalar,
+        Sse41,
+        Avx2
+    };
+
+    static void applyMask(const QRgb *source, const uchar *mask, QRgb *destination, int count);
+    static void applyMask(InstructionSet instructionSet, const QRgb *source, const uchar *mask, QRgb *destination, int count);
+    static QImage premultipliedSource(const QImage& image);
+    static InstructionSet instructionSet();
+
+    /**
+     * @brief Multiplies a premultiplied ARGB pixel by an 8-bit coverage value.
+     *
+     * @param pixel The premultiplied source pixel.
+     * @param alpha The coverage in range 0-255.
+     * @return The scaled premultiplied pixel.
+     */
+    static inline QRgb multiplyPixel(QRgb pixel, uint alpha)
+    {
+        uint redBlue = (pixel & 0xff00ff) * alpha;
+        redBlue = (redBlue + ((redBlue >> 8) & 0xff00ff) + 0x800080) >> 8;
+        redBlue &= 0xff00ff;
+
+        uint alphaGreen = ((pixel >> 8) & 0xff00ff) * alpha;
+        alphaGreen = alphaGreen + ((alphaGreen >> 8) & 0xff00ff) + 0x800080;
+        alphaGreen &= 0xff00ff00;
+
+        return alphaGreen | redBlue;
+    }
+};
+
+#endif // MASKAPPLYKERNEL_H
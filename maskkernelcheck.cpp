@@ -0,0 +1,226 @@
+#include "maskkernelcheck.h"
+#include "maskapplykernel.h"
+#include "puzzleoutlinerasterizer.h"
+#include "puzzleshapemanager.h"
+#include <QPainter>
+#include <QRandomGenerator>
+#include <algorithm>
+
+/**
+ * @class MaskKernelCheck
+ * @brief Checks the pieces cut by MaskApplyKernel against the pieces QPainter composites.
+ *
+ * The pieces of a puzzle generated on an image of random, partly transparent pixels are cut by
+ * every kernel the CPU supports and by QPainter. The masks are rasterized like PuzzleShapeManager
+ * does with the same settings. QPainter composites the pieces once with the same coverage mask,
+ * which isolates the arithmetic of the kernels, and once through an aliased clip path, as the
+ * pieces were cut before the kernel was introduced. The vector kernels have to match the scalar
+ * kernel exactly, and every kernel has to be within one step of the masked QPainter result and,
+ * with the default aliased masks, of the clip path cut. Anti-aliased scanline masks cannot match
+ * an aliased clip, so the clip path difference is only reported for them.
+ */
+
+
+namespace
+{
+const int maskTolerance = 1;
+
+struct Difference
+{
+    int maximum = 0;
+    qint64 pixels = 0;
+};
+
+QImage randomImage(const QSize& size, quint32 seed)
+{
+    QImage image(size, QImage::Format_ARGB32);
+    if (image.isNull())
+    {
+        return image;
+    }
+
+    QRandomGenerator random(seed);
+    for (int y = 0; y < image.height(); ++y)
+    {
+        QRgb *line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        random.fillRange(line, image.width());
+    }
+
+    return image;
+}
+
+QImage pieceMask(const QPainterPath& outline, const QRect& region, const PuzzleGenerationSettings& settings)
+{
+    if (settings.maskRasterizer == PuzzleGenerationSettings::ScanlineMask)
+    {
+        return PuzzleOutlineRasterizer::rasterize(outline, region, settings.flatteningTolerance);
+    }
+
+    QImage mask(region.size(), QImage::Format_Alpha8);
+    mask.fill(0);
+
+    QPainter painter(&mask);
+    painter.translate(-region.topLeft());
+    painter.fillPath(outline, Qt::black);
+    painter.end();
+
+    return mask;
+}
+
+QImage kernelCut(MaskApplyKernel::InstructionSet instructionSet, const QImage& source, const QImage& mask, const QRect& region)
+{
+    QImage shape(region.size(), QImage::Format_ARGB32_Premultiplied);
+
+    for (int y = 0; y < region.height(); ++y)
+    {
+        const QRgb *sourceLine = reinterpret_cast<const QRgb*>(source.constScanLine(region.y() + y)) + region.x();
+        QRgb *shapeLine = reinterpret_cast<QRgb*>(shape.scanLine(y));
+
+        MaskApplyKernel::applyMask(instructionSet, sourceLine, mask.constScanLine(y), shapeLine, region.width());
+    }
+
+    return shape;
+}
+
+QImage painterMaskCut(const QImage& source, const QImage& mask, const QRect& region)
+{
+    QImage shape(region.size(), QImage::Format_ARGB32_Premultiplied);
+    shape.fill(Qt::transparent);
+
+    QPainter painter(&shape);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.drawImage(QPoint(0, 0), source, region);
+    painter.setCompositionMode(QPainter::CompositionMode_DestinationIn);
+    painter.drawImage(QPoint(0, 0), mask);
+    painter.end();
+
+    return shape;
+}
+
+QImage painterClipCut(const QImage& source, const QPainterPath& outline, const QRect& region)
+{
+    QImage shape(region.size(), QImage::Format_ARGB32_Premultiplied);
+    shape.fill(Qt::transparent);
+
+    QPainter painter(&shape);
+    painter.translate(-region.topLeft());
+    painter.setClipPath(outline);
+    painter.drawImage(region.topLeft(), source, region);
+    painter.end();
+
+    return shape;
+}
+
+void compareImages(const QImage& image, const QImage& reference, Difference& difference)
+{
+    for (int y = 0; y < image.height(); ++y)
+    {
+        const uchar *line = image.constScanLine(y);
+        const uchar *referenceLine = reference.constScanLine(y);
+        for (int x = 0; x < image.width(); ++x)
+        {
+            int pixelDifference = 0;
+            for (int channel = 0; channel < 4; ++channel)
+            {
+                pixelDifference = qMax(pixelDifference, qAbs(int(line[x * 4 + channel]) - int(referenceLine[x * 4 + channel])));
+            }
+
+            if (pixelDifference != 0)
+            {
+                difference.maximum = qMax(difference.maximum, pixelDifference);
+                difference.pixels++;
+            }
+        }
+    }
+}
+}
+
+/**
+ * @brief Generates a puzzle on a random image and compares the pieces cut by each kernel and by QPainter.
+ *
+ * @param rows Number of rows in the puzzle.
+ * @param columns Number of columns in the puzzle.
+ * @param imageSize The size of the puzzle image.
+ * @param settings The settings of the puzzle, the seed also seeds the image pixels and the mask rasterizer is the one checked.
+ * @param output The stream the results are written to.
+ * @return True if every kernel matches; false if one does not or the image could not be allocated.
+ */
+bool MaskKernelCheck::run(int rows, int columns, const QSize& imageSize, const PuzzleGenerationSettings& settings, QTextStream& output)
+{
+    QImage image = randomImage(imageSize, settings.seed);
+    if (image.isNull())
+    {
+        output << "cannot allocate a " << imageSize.width() << "x" << imageSize.height() << " image" << Qt::endl;
+        return false;
+    }
+    QImage source = MaskApplyKernel::premultipliedSource(image);
+
+    PuzzleGenerationSettings generationSettings = settings;
+    generationSettings.useMaskCache = false;
+    generationSettings.useAtlas = false;
+    PuzzleShapeManager manager(rows, columns, image, generationSettings);
+    manager.generate();
+
+    QList<int> pieceIds = manager.shapeRegions().keys();
+    std::sort(pieceIds.begin(), pieceIds.end());
+
+    QVector<MaskApplyKernel::InstructionSet> instructionSets = {MaskApplyKernel::Scalar};
+    if (MaskApplyKernel::instructionSet() >= MaskApplyKernel::Sse41)
+    {
+        instructionSets.append(MaskApplyKernel::Sse41);
+    }
+    if (MaskApplyKernel::instructionSet() >= MaskApplyKernel::Avx2)
+    {
+        instructionSets.append(MaskApplyKernel::Avx2);
+    }
+    const QStringList instructionSetNames = {"scalar", "sse4.1", "avx2"};
+
+    QVector<Difference> maskDifferences(instructionSets.count());
+    QVector<Difference> clipDifferences(instructionSets.count());
+    QVector<Difference> scalarDifferences(instructionSets.count());
+
+    for (int pieceId : std::as_const(pieceIds))
+    {
+        QPainterPath outline = manager.pieceOutline(pieceId);
+        QRect region = manager.shapeRegions().value(pieceId);
+        QImage mask = pieceMask(outline, region, settings);
+
+        QImage maskReference = painterMaskCut(source, mask, region);
+        QImage clipReference = painterClipCut(source, outline, region);
+
+        QImage scalarPiece;
+        for (int i = 0; i < instructionSets.count(); ++i)
+        {
+            QImage piece = kernelCut(instructionSets[i], source, mask, region);
+            if (i == 0)
+            {
+                scalarPiece = piece;
+            }
+
+            compareImages(piece, maskReference, maskDifferences[i]);
+            compareImages(piece, clipReference, clipDifferences[i]);
+            compareImages(piece, scalarPiece, scalarDifferences[i]);
+        }
+    }
+
+    output << pieceIds.count() << " pieces, maximum channel difference of the kernel pieces" << Qt::endl;
+
+    bool checkClipPath = settings.maskRasterizer == PuzzleGenerationSettings::PainterMask;
+    bool matching = true;
+    for (int i = 0; i < instructionSets.count(); ++i)
+    {
+        output << instructionSetNames[instructionSets[i]] << ": " << maskDifferences[i].maximum << "/255 against QPainter with the same mask ("
+               << maskDifferences[i].pixels << " pixels), " << clipDifferences[i].maximum << "/255 against the QPainter clip path ("
+               << clipDifferences[i].pixels << " pixels), " << scalarDifferences[i].maximum << "/255 against the scalar kernel" << Qt::endl;
+
+        matching = matching && maskDifferences[i].maximum <= maskTolerance && scalarDifferences[i].maximum == 0
+                   && (!checkClipPath || clipDifferences[i].maximum <= maskTolerance);
+    }
+
+    if (!checkClipPath)
+    {
+        output << "the clip path is not checked, the scanline rasterizer anti-aliases the piece edges" << Qt::endl;
+    }
+    output << (matching ? "all kernels match" : "kernel mismatch") << Qt::endl;
+    return matching;
+}
@@ -0,0 +1,14 @@
+#ifndef MASKKERNELCHECK_H
+#define MASKKERNELCHECK_H
+
+#include "puzzlegenerationsettings.h"
+#include <QSize>
+#include <QTextStream>
+
+class MaskKernelCheck
+{
+public:
+    static bool run(int rows, int columns, const QSize& imageSize, const PuzzleGenerationSettings& settings, QTextStream& output);
+};
+
+#endif // MASKKERNELCHECK_H
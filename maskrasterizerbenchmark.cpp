@@ -0,0 +1,187 @@
+#include "maskrasterizerbenchmark.h"
+#include "puzzleoutlinerasterizer.h"
+#include "puzzleshapemanager.h"
+#include <QElapsedTimer>
+#include <QPainter>
+#include <algorithm>
+#include <functional>
+
+/**
+ * @class MaskRasterizerBenchmark
+ * @brief Compares the piece mask rasterizers on speed and coverage error.
+ *
+ * The pieces of a generated puzzle are rasterized with QPainter, aliased and anti-aliased, and
+ * with PuzzleOutlineRasterizer. The error of each is measured against a reference mask sampled
+ * 256 times per pixel, on the first pieces of the puzzle.
+ */
+
+
+namespace
+{
+const int referenceScale = 16;
+const int referencePieceCount = 16;
+
+struct CoverageError
+{
+    int maximum = 0;
+    qint64 boundarySum = 0;
+    qint64 boundaryPixels = 0;
+};
+
+QImage painterMask(const QPainterPath& outline, const QRect& region, bool antialiased)
+{
+    QImage mask(region.size(), QImage::Format_Alpha8);
+    mask.fill(0);
+
+    QPainter painter(&mask);
+    painter.setRenderHint(QPainter::Antialiasing, antialiased);
+    painter.translate(-region.topLeft());
+    painter.fillPath(outline, Qt::black);
+    painter.end();
+
+    return mask;
+}
+
+QImage referenceMask(const QPainterPath& outline, const QRect& region)
+{
+    QImage samples(region.size() * referenceScale, QImage::Format_Alpha8);
+    samples.fill(0);
+
+    QPainter painter(&samples);
+    painter.scale(referenceScale, referenceScale);
+    painter.translate(-region.topLeft());
+    painter.fillPath(outline, Qt::black);
+    painter.end();
+
+    QImage mask(region.size(), QImage::Format_Alpha8);
+    for (int y = 0; y < mask.height(); ++y)
+    {
+        uchar *maskLine = mask.scanLine(y);
+        for (int x = 0; x < mask.width(); ++x)
+        {
+            int sum = 0;
+            for (int sampleY = 0; sampleY < referenceScale; ++sampleY)
+            {
+                const uchar *sampleLine = samples.constScanLine(y * referenceScale + sampleY) + x * referenceScale;
+                for (int sampleX = 0; sampleX < referenceScale; ++sampleX)
+                {
+                    sum += sampleLine[sampleX];
+                }
+            }
+            maskLine[x] = uchar((sum + referenceScale * referenceScale / 2) / (referenceScale * referenceScale));
+        }
+    }
+
+    return mask;
+}
+
+void compareMasks(const QImage& mask, const QImage& reference, CoverageError& error)
+{
+    for (int y = 0; y < mask.height(); ++y)
+    {
+        const uchar *maskLine = mask.constScanLine(y);
+        const uchar *referenceLine = reference.constScanLine(y);
+        for (int x = 0; x < mask.width(); ++x)
+        {
+            int difference = qAbs(int(maskLine[x]) - int(referenceLine[x]));
+            error.maximum = qMax(error.maximum, difference);
+
+            bool maskBoundary = maskLine[x] != 0 && maskLine[x] != 255;
+            bool referenceBoundary = referenceLine[x] != 0 && referenceLine[x] != 255;
+            if (maskBoundary || referenceBoundary || difference != 0)
+            {
+                error.boundarySum += difference;
+                error.boundaryPixels++;
+            }
+        }
+    }
+}
+}
+
+/**
+ * @brief Generates a puzzle on a blank image and reports the speed and error of every rasterizer.
+ *
+ * @param rows Number of rows in the puzzle.
+ * @param columns Number of columns in the puzzle.
+ * @param imageSize The size of the puzzle image.
+ * @param settings The settings of the puzzle, the flattening tolerance is used by the scanline rasterizer.
+ * @param output The stream the results are written to.
+ * @return True if the benchmark ran; false if the image could not be allocated.
+ */
+bool MaskRasterizerBenchmark::run(int rows, int columns, const QSize& imageSize, const PuzzleGenerationSettings& settings, QTextStream& output)
+{
+    QImage image(imageSize, QImage::Format_ARGB32_Premultiplied);
+    if (image.isNull())
+    {
+        output << "cannot allocate a " << imageSize.width() << "x" << imageSize.height() << " image" << Qt::endl;
+        return false;
+    }
+    image.fill(Qt::white);
+
+    PuzzleGenerationSettings generationSettings = settings;
+    generationSettings.useMaskCache = false;
+    generationSettings.useAtlas = false;
+    PuzzleShapeManager manager(rows, columns, image, generationSettings);
+    manager.generate();
+
+    QList<int> pieceIds = manager.shapeRegions().keys();
+    std::sort(pieceIds.begin(), pieceIds.end());
+
+    QVector<QPainterPath> outlines;
+    QVector<QRect> regions;
+    QVector<QImage> references;
+    for (int pieceId : std::as_const(pieceIds))
+    {
+        outlines.append(manager.pieceOutline(pieceId));
+        regions.append(manager.shapeRegions().value(pieceId));
+        if (references.count() < referencePieceCount)
+        {
+            references.append(referenceMask(outlines.last(), regions.last()));
+        }
+    }
+
+    struct Rasterizer
+    {
+        QString name;
+        std::function<QImage(const QPainterPath&, const QRect&)> rasterize;
+    };
+
+    qreal tolerance = settings.flatteningTolerance;
+    const QList<Rasterizer> rasterizers = {
+        {"painter", [](const QPainterPath& outline, const QRect& region) { return painterMask(outline, region, false); }},
+        {"painter-aa", [](const QPainterPath& outline, const QRect& region) { return painterMask(outline, region, true); }},
+        {"scanline", [tolerance](const QPainterPath& outline, const QRect& region) { return PuzzleOutlineRasterizer::rasterize(outline, region, tolerance); }}
+    };
+
+    output << outlines.count() << " pieces, coverage error on " << references.count() << " pieces against "
+           << referenceScale * referenceScale << " samples per pixel" << Qt::endl;
+
+    for (const Rasterizer &rasterizer : rasterizers)
+    {
+        QVector<QImage> masks;
+        QElapsedTimer timer;
+        timer.start();
+        for (int i = 0; i < outlines.count(); ++i)
+        {
+            QImage mask = rasterizer.rasterize(outlines[i], regions[i]);
+            if (i < references.count())
+            {
+                masks.append(mask);
+            }
+        }
+        qint64 elapsed = timer.nsecsElapsed();
+
+        CoverageError error;
+        for (int i = 0; i < references.count(); ++i)
+        {
+            compareMasks(masks[i], references[i], error);
+        }
+
+        output << rasterizer.name << ": " << elapsed / 1000000.0 << " ms, "
+               << elapsed / 1000.0 / qMax(1, int(outlines.count())) << " us per piece, max error " << error.maximum
+               << "/255, mean boundary error " << (error.boundaryPixels ? qreal(error.boundarySum) / error.boundaryPixels : 0.0)
+               << "/255" << Qt::endl;
+    }
+
+    return true;
+}
@@ -0,0 +1,14 @@
+#ifndef MASKRASTERIZERBENCHMARK_H
+#define MASKRASTERIZERBENCHMARK_H
+
+#include "puzzlegenerationsettings.h"
+#include <QSize>
+#include <QTextStream>
+
+class MaskRasterizerBenchmark
+{
+public:
+    static bool run(int rows, int columns, const QSize& imageSize, const PuzzleGenerationSettings& settings, QTextStream& output);
+};
+
+#endif // MASKRASTERIZERBENCHMARK_H
@@ -9,24 +9,31 @@
 #include <QStackedWidget>
 #include <QDrag>
 #include <QMimeData>
+#include <QMessageBox>
 
 /**
  * @class PlayPuzzleGameDialog
  * @brief The PlayPuzzleGameDialog class represents a dialog for playing with the puzzle shapes.
  *
  * This dialog allows users to play puzzle games by dragging and dropping image pieces.
+ * Pieces dropped next to their neighbours snap together, and the dialog tells when the puzzle is complete.
+ * A status line below the board shows the pieces placed and, once a second, how many frames the board
+ * painted and how many pixels each of them covered on average.
  */
 
 
-PlayPuzzleGameDialog::PlayPuzzleGameDialog(int rows, int columns, QImage& image, QSize &biggestShape, QWidget *parent) :
+PlayPuzzleGameDialog::PlayPuzzleGameDialog(int rows, int columns, const QSize& boardSize, QSize &biggestShape, QWidget *parent) :
     QDialog(parent)
     , ui(new Ui::PlayPuzzleGameDialog)
     , imageHolderWidget(new ImageHolderWidget(biggestShape,this))
     , scrollArea(new QScrollArea)
+    , statusLabel(new QLabel)
+    , statusTimer(new QTimer(this))
     , rows(rows)
     , columns(columns)
-    , width(image.width())
-    , height(image.height())
+    , puzzlePieceCount(0)
+    , width(boardSize.width())
+    , height(boardSize.height())
     , biggestShape(biggestShape)
 {
     ui->setupUi(this);
@@ -34,11 +41,12 @@ PlayPuzzleGameDialog::PlayPuzzleGameDialog(int rows, int columns, QImage& image,
 
     scrollArea->setWidget(imageHolderWidget);
 
-    imageHolderWidget->setFixedSize(image.width(), image.height());
+    imageHolderWidget->setFixedSize(boardSize);
     imageHolderWidget->setPalette(QPalette(Qt::darkRed));
 
     QVBoxLayout *layout = new QVBoxLayout;
     layout->addWidget(scrollArea);
+    layout->addWidget(statusLabel);
     setLayout(layout);
 
     QScreen *screen = QGuiApplication::primaryScreen();
@@ -48,7 +56,12 @@ PlayPuzzleGameDialog::PlayPuzzleGameDialog(int rows, int columns, QImage& image,
     resize(desiredWidth, desiredHeight);
     this->move(0,0);
 
-    connect(imageHolderWidget, &ImageHolderWidget::handleDropEvent, this, &PlayPuzzleGameDialog::handleDropEvent);
+    connect(imageHolderWidget, &ImageHolderWidget::pieceDropped, this, &PlayPuzzleGameDialog::handleDropEvent);
+    connect(imageHolderWidget, &ImageHolderWidget::puzzleCompleted, this, &PlayPuzzleGameDialog::showCompleted);
+
+    connect(statusTimer, &QTimer::timeout, this, &PlayPuzzleGameDialog::updateStatus);
+    statusTimer->start(1000);
+    updateStatus();
 }
 
 PlayPuzzleGameDialog::~PlayPuzzleGameDialog()
@@ -56,6 +69,39 @@ PlayPuzzleGameDialog::~PlayPuzzleGameDialog()
     delete ui;
 }
 
+/**
+ * @brief Sets the store the pieces dropped on the board are taken from.
+ *
+ * @param store The piece store shared with the piece pool.
+ */
+void PlayPuzzleGameDialog::setPieceStore(const QSharedPointer<PuzzlePieceStore>& store)
+{
+    imageHolderWidget->setPieceStore(store);
+}
+
+/**
+ * @brief Sets the registry shared with the piece pool.
+ *
+ * @param registry The piece registry.
+ */
+void PlayPuzzleGameDialog::setPieceRegistry(const QSharedPointer<PuzzlePieceRegistry>& registry)
+{
+    imageHolderWidget->setPieceRegistry(registry);
+}
+
+/**
+ * @brief Sets where the pieces belong, so that matching pieces snap together on the board.
+ *
+ * @param layout The layout the pieces were cut from.
+ * @param regions The regions the pieces were cut from, keyed by piece id.
+ */
+void PlayPuzzleGameDialog::setSolution(const PuzzleLayout& layout, const QHash<int, QRect>& regions)
+{
+    puzzlePieceCount = layout.cellCount();
+    imageHolderWidget->setSolution(layout, regions);
+    updateStatus();
+}
+
 /**
  * @brief Resizes the dialog.
  */
@@ -65,39 +111,46 @@ void PlayPuzzleGameDialog::resizeDialog()
 }
 
 /**
- * @brief Handles the drop event by adding a new image label to the image holder widget.
+ * @brief Handles a piece placed on the board from the pool by removing it from the pool.
  *
- * @param newImage The new image label.
- * @param fileName The name of the file associated with the image.
- * @param dropPos The position where the image is dropped.
+ * @param pieceId The id of the piece.
  */
-void PlayPuzzleGameDialog::handleDropEvent(QLabel *newImage, QString fileName, QPoint dropPos)
+void PlayPuzzleGameDialog::handleDropEvent(int pieceId)
 {
-    newImage->setParent(imageHolderWidget);
-    newImage->move(dropPos);
-    newImage->setProperty("itemName", QVariant::fromValue(fileName));
-    newImage->show();
-
-    emit deleteShapeFromPool(fileName);
+    emit deleteShapeFromPool(pieceId);
 }
 
 /**
- * @brief Deletes the label with the specified name from the image holder widget.
+ * @brief Takes a piece off the board.
  *
- * @param name The name of the label to delete.
+ * @param pieceId The id of the piece to remove.
+ */
+void PlayPuzzleGameDialog::removePiece(int pieceId)
+{
+    imageHolderWidget->removePiece(pieceId);
+}
+
+/**
+ * @brief Tells the player that every piece has been joined.
+ */
+void PlayPuzzleGameDialog::showCompleted()
+{
+    QMessageBox::information(this, windowTitle(), tr("The puzzle is complete."));
+}
+
+/**
+ * @brief Shows the pieces on the board and the board painting of the last second in the status line.
  */
-void PlayPuzzleGameDialog::deleteLabelWithName(QString name)
+void PlayPuzzleGameDialog::updateStatus()
 {
-    foreach (QObject *child, imageHolderWidget->children())
-    {
-        QLabel *existingLabel = qobject_cast<QLabel*>(child);
-        if (existingLabel && existingLabel->property("itemName").toString() == name)
-        {
-            existingLabel->setParent(nullptr);
-            delete existingLabel;
-            imageHolderWidget->update();
-
-            return;
-        }
-    }
+    const ImageHolderWidget::PaintStatistics &statistics = imageHolderWidget->paintStatistics();
+    quint64 pixelsPerFrame = statistics.frames > 0 ? statistics.paintedPixels / statistics.frames : 0;
+
+    statusLabel->setText(tr("%1 of %2 pieces on the board, %3 frames/s, %4 pixels painted per frame")
+                             .arg(imageHolderWidget->pieceCount())
+                             .arg(puzzlePieceCount)
+                             .arg(statistics.frames)
+                             .arg(pixelsPerFrame));
+
+    imageHolderWidget->resetPaintStatistics();
 }
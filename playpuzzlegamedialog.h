@@ -9,6 +9,7 @@
 #include <QPushButton>
 #include <QScrollArea>
 #include <QListView>
+#include <QTimer>
 
 namespace Ui {
 class PlayPuzzleGameDialog;
@@ -19,28 +20,37 @@ class PlayPuzzleGameDialog : public QDialog
     Q_OBJECT
 
 public:
-    explicit PlayPuzzleGameDialog(int rows, int columns, QImage& image, QSize &biggestShape, QWidget *parent = nullptr);
+    explicit PlayPuzzleGameDialog(int rows, int columns, const QSize& boardSize, QSize &biggestShape, QWidget *parent = nullptr);
     ~PlayPuzzleGameDialog();
 
+    void setPieceStore(const QSharedPointer<PuzzlePieceStore>& store);
+    void setPieceRegistry(const QSharedPointer<PuzzlePieceRegistry>& registry);
+    void setSolution(const PuzzleLayout& layout, const QHash<int, QRect>& regions);
+
 public slots:
     void resizeDialog();
-    void handleDropEvent(QLabel* newImage, QString fileName, QPoint dropPos);
-    void deleteLabelWithName(QString name);
+    void handleDropEvent(int pieceId);
+    void removePiece(int pieceId);
+    void showCompleted();
+    void updateStatus();
 
 private:
     Ui::PlayPuzzleGameDialog *ui;
 
     ImageHolderWidget *imageHolderWidget;
     QScrollArea *scrollArea;
+    QLabel *statusLabel;
+    QTimer *statusTimer;
 
     int rows;
     int columns;
+    int puzzlePieceCount;
     int width;
     int height;
     QSize biggestShape;
 
 signals:
-    void deleteShapeFromPool(QString fileName);
+    void deleteShapeFromPool(int pieceId);
 
 };
 
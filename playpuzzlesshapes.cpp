@@ -5,7 +5,6 @@
 #include <QScrollArea>
 #include <QListView>
 #include <QDropEvent>
-#include <QStandardItemModel>
 #include <QVBoxLayout>
 #include <QRandomGenerator>
 #include <QMimeData>
@@ -15,22 +14,35 @@
  * @brief The PlayPuzzlesShapes class represents a dialog for managing puzzle shapes.
  *
  * This dialog allows users to manage puzzle shapes by dragging and dropping them.
+ * The row of every piece is kept in the PuzzlePieceRegistry shared with the board, so pieces are
+ * found, moved and removed by id without scanning the rows. The pool shows a PuzzlePieceListModel
+ * with uniform item sizes and batched layout, and resizing only lays the grid out again.
  */
 
 
-PlayPuzzlesShapes::PlayPuzzlesShapes(QStandardItemModel *model, const QSize &biggestShape, QWidget *parent)
+PlayPuzzlesShapes::PlayPuzzlesShapes(const QVector<int> &pieceIds, const QSize &biggestShape, QWidget *parent)
     : QDialog(parent)
     , ui(new Ui::PlayPuzzlesShapes)
     , scrollView(new QScrollArea(this))
     , listView(new CustomListView())
-    , maxShapeNumber(model->rowCount())
+    , itemDelegate(new ItemHideNameDelegate(this))
+    , pieceModel(new PuzzlePieceListModel(this))
+    , maxShapeNumber(pieceIds.count())
 {
     ui->setupUi(this);
 
     listView->setViewMode(QListView::IconMode);
+    listView->setMovement(QListView::Static);
+    listView->setResizeMode(QListView::Adjust);
+    listView->setUniformItemSizes(true);
+    listView->setLayoutMode(QListView::Batched);
     listView->setIconSize(biggestShape);
-    listView->setModel(nullptr);
-    listView->setModel(prepareItemsForView(model));
+    pieceModel->setIconSize(biggestShape);
+
+    itemDelegate->displayRoleEnabled = false;
+    listView->setItemDelegate(itemDelegate);
+    pieceModel->setPieceIds(shufflePieces(pieceIds));
+    listView->setModel(pieceModel);
 
     listView->setDragEnabled(true);
     listView->setAcceptDrops(true);//
@@ -65,113 +77,84 @@ PlayPuzzlesShapes::~PlayPuzzlesShapes()
 }
 
 /**
-     * @brief Deletes the item with the specified name from the list view.
-     *
-     * @param name The name of the item to delete.
-     */
-void PlayPuzzlesShapes::deleteItemWithName(QString name)
+ * @brief Sets the store dragged and dropped pieces are looked up in.
+ *
+ * Pieces of an atlas are drawn from the atlas of the store.
+ *
+ * @param store The piece store shared with the board.
+ */
+void PlayPuzzlesShapes::setPieceStore(const QSharedPointer<PuzzlePieceStore> &store)
 {
-    QStandardItemModel *model = qobject_cast<QStandardItemModel*>(listView->model());
-    if (!model)
+    pieceStore = store;
+    listView->setPieceStore(store);
+    itemDelegate->setPieceStore(store);
+    pieceModel->setPieceStore(store);
+}
+
+/**
+ * @brief Sets the registry the rows of the pieces are recorded in and records the current rows.
+ *
+ * @param registry The piece registry shared with the board.
+ */
+void PlayPuzzlesShapes::setPieceRegistry(const QSharedPointer<PuzzlePieceRegistry> &registry)
+{
+    pieceRegistry = registry;
+    if (!pieceRegistry)
     {
         return;
     }
 
-    QString nameWithoutSpaces = name.simplified();
-
-    for (int row = 0; row < model->rowCount(); ++row)
+    for (int row = 0; row < pieceModel->rowCount(); ++row)
     {
-        QModelIndex index = model->index(row, 0);
-        if (index.isValid())
-        {
-            QStandardItem *item = model->itemFromIndex(index);
-            if (item)
-            {
-                QString itemName = item->text().simplified();
-                if (itemName.compare(nameWithoutSpaces, Qt::CaseInsensitive) == 0)
-                {
-                    model->removeRow(row);
-                    return;
-                }
-            }
-        }
+        pieceRegistry->placeInTray(pieceModel->pieceId(row), pieceModel->index(row));
     }
 }
 
 /**
-     * @brief Handles resize events for the dialog.
-     *
-     * @param event The resize event.
-     */
-void PlayPuzzlesShapes::resizeEvent(QResizeEvent *event)
+ * @brief Removes a piece from the list view.
+ *
+ * @param pieceId The id of the piece to remove.
+ */
+void PlayPuzzlesShapes::removePiece(int pieceId)
 {
-    QDialog::resizeEvent(event);
-    updateListViewItems();
-}
+    if (!pieceRegistry)
+    {
+        return;
+    }
 
-/**
-     * @brief Updates the items in the list view.
-     */
-void PlayPuzzlesShapes::updateListViewItems()
-{
-    QStandardItemModel *model = qobject_cast<QStandardItemModel*>(listView->model());
-    if (model)
+    QPersistentModelIndex index = pieceRegistry->trayIndex(pieceId);
+    if (index.isValid())
     {
-        listView->setModel(nullptr);
-        listView->setModel(model);
+        pieceRegistry->remove(pieceId);
+        pieceModel->removePiece(index.row());
     }
 }
 
 /**
-     * @brief Prepares the items for display in the list view.
-     *
-     * @param model The model containing the puzzle shapes.
-     * @return A model containing the prepared items.
-     */
-QStandardItemModel *PlayPuzzlesShapes::prepareItemsForView(QStandardItemModel *model)
+ * @brief Shuffles the pieces for the pool.
+ *
+ * @param pieceIds The piece ids.
+ * @return The piece ids in random order.
+ */
+QVector<int> PlayPuzzlesShapes::shufflePieces(const QVector<int> &pieceIds) const
 {
-    if (!model)
-    {
-        return nullptr;
-    }
-
-    QStandardItemModel *unsortedModel = new QStandardItemModel(this);
-    QList<QStandardItem *> items;
-
-    for (int i = 0; i < model->rowCount(); ++i)
-    {
-        for (int j = 0; j < model->columnCount(); ++j)
-        {
-            QStandardItem *item = model->item(i, j)->clone();
-            item->setText(" " + item->text());
-            items.append(item);
-        }
-    }
+    QVector<int> pieces = pieceIds;
 
     QRandomGenerator generator = QRandomGenerator::securelySeeded();
-    for (int i = items.size() - 1; i > 0; --i)
+    for (int i = pieces.size() - 1; i > 0; --i)
     {
         int randomIndex = generator.bounded(i + 1);
-        items.swapItemsAt(i, randomIndex);
-    }
-
-    for (auto item : items)
-    {
-        unsortedModel->appendRow(item);
+        pieces.swapItemsAt(i, randomIndex);
     }
 
-    ItemHideNameDelegate *delegate = new ItemHideNameDelegate(this);
-    delegate->displayRoleEnabled = false;
-    listView->setItemDelegate(delegate);
-
-    return unsortedModel;
+    return pieces;
 }
 
 /**
-     * @brief Handles the item dropped event for the list view. Does it based on type of mime data format.
-     *
-     * @param event The drop event.
-     */
+ * @brief Handles the item dropped event for the list view. Does it based on type of mime data format.
+ *
+ * @param event The drop event.
+ */
 void PlayPuzzlesShapes::handleItemDropped(QDropEvent *event)
 {
     if(event)
@@ -179,75 +162,32 @@ void PlayPuzzlesShapes::handleItemDropped(QDropEvent *event)
         QPoint dropPos = event->position().toPoint();
         QModelIndex dropIndex = listView->indexAt(dropPos);
 
-        QStandardItem* item = nullptr;
-        if(event->mimeData()->hasFormat("application/x-custom-listView-data"))
-        {
-            QByteArray itemData = event->mimeData()->data("application/x-custom-listView-data");
-            QDataStream dataStream(&itemData, QIODevice::ReadOnly);
-            QPixmap pixmap;
-            QString labelName;
-            QPoint offset;
-            dataStream >> pixmap >> labelName >> offset;
-            item = new QStandardItem(QIcon(pixmap), labelName);
-        }else if(event->mimeData()->hasFormat("application/x-custom-item-data"))
+        int pieceId = -1;
+        bool fromBoard = PuzzlePieceStore::decodePiece(event->mimeData(), "application/x-custom-item-data", &pieceId);
+        if (!fromBoard && !PuzzlePieceStore::decodePiece(event->mimeData(), "application/x-custom-listView-data", &pieceId))
         {
-            QByteArray itemData = event->mimeData()->data("application/x-custom-item-data");
-            QDataStream dataStream(&itemData, QIODevice::ReadOnly);
-            QPixmap pixmap;
-            QString labelName;
-            dataStream >> pixmap >> labelName;
-            item = new QStandardItem(QIcon(pixmap), labelName);
-
-            emit dropEventReceived(labelName);
-        } else
+            return;
+        }
+
+        if (!pieceStore || !pieceRegistry || !pieceStore->contains(pieceId))
         {
             return;
         }
 
+        if (fromBoard)
+        {
+            emit dropEventReceived(pieceId);
+        }
 
-        if (item)
+        int row = dropIndex.isValid() ? dropIndex.row() : pieceModel->rowCount();
+        QPersistentModelIndex existingIndex = pieceRegistry->trayIndex(pieceId);
+        if (existingIndex.isValid())
+        {
+            pieceModel->movePiece(existingIndex.row(), row);
+        }else if(pieceModel->rowCount()<maxShapeNumber)
         {
-            QStandardItemModel *targetModel = qobject_cast<QStandardItemModel*>(listView->model());
-            if (targetModel)
-            {
-                QString droppedItemText = item->text();
-
-                for (int row = 0; row < targetModel->rowCount(); ++row)
-                {
-                    for (int column = 0; column < targetModel->columnCount(); ++column)
-                    {
-                        QModelIndex index = targetModel->index(row, column);
-                        if (index.isValid())
-                        {
-                            QStandardItem* existingItem = targetModel->itemFromIndex(index);
-                            if (existingItem && existingItem->text() == droppedItemText)
-                            {
-                                if (!dropIndex.isValid())
-                                {
-                                    targetModel->removeRow(index.row(), index.parent());
-                                    targetModel->appendRow(item);
-                                }else
-                                {
-                                    targetModel->removeRow(index.row(), index.parent());
-                                    targetModel->insertRow(dropIndex.row(), item);
-                                }
-                                return;
-                            }
-                        }
-                    }
-                }
-
-                if(targetModel->rowCount()<maxShapeNumber)
-                {
-                    if (!dropIndex.isValid())
-                    {
-                        targetModel->appendRow(item);
-                    }else
-                    {
-                        targetModel->insertRow(dropIndex.row(), item);
-                    }
-                }
-            }
+            pieceModel->insertPiece(row, pieceId);
+            pieceRegistry->placeInTray(pieceId, pieceModel->index(qMin(row, pieceModel->rowCount() - 1)));
         }
     }
 }
@@ -2,10 +2,12 @@
 #define PLAYPUZZLESSHAPES_H
 
 #include "customlistview.h"
+#include "itemhidenamedelegate.h"
+#include "puzzlepiecelistmodel.h"
+#include "puzzlepieceregistry.h"
 #include <QDialog>
 #include <QScrollArea>
 #include <QListView>
-#include <QStandardItemModel>
 
 namespace Ui {
 class PlayPuzzlesShapes;
@@ -16,14 +18,16 @@ class PlayPuzzlesShapes : public QDialog
     Q_OBJECT
 
 public:
-    explicit PlayPuzzlesShapes(QStandardItemModel *model, const QSize &biggestShape ,QWidget *parent = nullptr);
+    explicit PlayPuzzlesShapes(const QVector<int> &pieceIds, const QSize &biggestShape ,QWidget *parent = nullptr);
     ~PlayPuzzlesShapes();
 
+    void setPieceStore(const QSharedPointer<PuzzlePieceStore>& store);
+    void setPieceRegistry(const QSharedPointer<PuzzlePieceRegistry>& registry);
+
 public slots:
-    void deleteItemWithName(QString name);
+    void removePiece(int pieceId);
 
 protected:
-    void resizeEvent(QResizeEvent *event) override;
     bool dropMimeData(int row, int column, const QMimeData *data, Qt::DropAction action);
 
 private:
@@ -31,17 +35,20 @@ private:
 
     QScrollArea *scrollView;
     CustomListView *listView;
+    ItemHideNameDelegate *itemDelegate;
+    PuzzlePieceListModel *pieceModel;
     int maxShapeNumber;
+    QSharedPointer<PuzzlePieceStore> pieceStore;
+    QSharedPointer<PuzzlePieceRegistry> pieceRegistry;
 
-    void updateListViewItems();
-    QStandardItemModel* prepareItemsForView(QStandardItemModel *model);
+    QVector<int> shufflePieces(const QVector<int> &pieceIds) const;
 
 private slots:
     void handleItemDropped(QDropEvent *event);
 
 signals:
-    void dropEventReceived(QString fileName);
-    void deleteShapeFromPool(QString fileName);
+    void dropEventReceived(int pieceId);
+    void deleteShapeFromPool(int pieceId);
 };
 
 #endif // PLAYPUZZLESSHAPES_H
@@ -0,0 +1,377 @@
+#include "puzzlebatchgenerator.h"
+#include "puzzleshapemanager.h"
+#include <QColorSpace>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QMutexLocker>
+#include <QSet>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+/**
+ * @class PuzzleBatchGenerator
+ * @brief Generates puzzles for many images without creating any widgets.
+ *
+ * Every image is loaded, divided with PuzzleShapeManager and written to its own directory
+ * below the output directory as preview.jpg and one piece_<id>.png per piece, or as a single
+ * pieces.mpcpack PuzzlePiecePack file. Several images
+ * are processed at once, and the available cores are shared between them for cutting.
+ */
+
+
+namespace
+{
+const int minimumShapeSpacing = 57; // same lower bound as PuzzleSetUpSettingsDialog, approximate pixels for 1.5cm
+}
+
+PuzzleBatchGenerator::PuzzleBatchGenerator(int rows, int columns, const PuzzleGenerationSettings &settings, const QString &outputDirectory, QObject *parent)
+    : QObject(parent)
+    , rows(rows)
+    , columns(columns)
+    , concurrentImages(qMax(1, QThread::idealThreadCount()))
+    , forceTiled(false)
+    , writePiecePack(false)
+    , settings(settings)
+    , outputDirectory(outputDirectory)
+{}
+
+/**
+ * @brief Expands the given files and directories into a list of readable image files.
+ *
+ * @param paths Image files or directories containing image files.
+ * @return The image files, directories expanded in name order.
+ */
+QStringList PuzzleBatchGenerator::collectImageFiles(const QStringList &paths)
+{
+    QStringList nameFilters;
+    const QList<QByteArray> supportedFormats = QImageReader::supportedImageFormats();
+    for (const QByteArray &format : supportedFormats)
+    {
+        nameFilters.append("*." + QString::fromLatin1(format));
+    }
+
+    QStringList imageFiles;
+    for (const QString &path : paths)
+    {
+        QFileInfo pathInfo(path);
+        if (pathInfo.isDir())
+        {
+            QDir directory(path);
+            const QFileInfoList entries = directory.entryInfoList(nameFilters, QDir::Files | QDir::Readable, QDir::Name);
+            for (const QFileInfo &entry : entries)
+            {
+                imageFiles.append(entry.filePath());
+            }
+        } else
+        {
+            imageFiles.append(path);
+        }
+    }
+
+    return imageFiles;
+}
+
+/**
+ * @brief Chooses the output directory of every image so that no two images share one.
+ *
+ * An image is written to a directory named after its base name. Images sharing a base name,
+ * such as a.jpg and a.png, also get their suffix, and any name still taken gets an index.
+ * Names are compared case insensitively, as the file system may do.
+ *
+ * @param imageFiles The image files to process.
+ * @return The directory name of every image, in the order of imageFiles.
+ */
+QStringList PuzzleBatchGenerator::outputDirectoryNames(const QStringList &imageFiles)
+{
+    QHash<QString, int> baseNameCounts;
+    for (const QString &fileName : imageFiles)
+    {
+        ++baseNameCounts[QFileInfo(fileName).completeBaseName().toLower()];
+    }
+
+    QStringList directoryNames;
+    QSet<QString> usedNames;
+    for (const QString &fileName : imageFiles)
+    {
+        QFileInfo fileInfo(fileName);
+        QString name = fileInfo.completeBaseName();
+        if (baseNameCounts.value(name.toLower()) > 1 && !fileInfo.suffix().isEmpty())
+        {
+            name += "_" + fileInfo.suffix();
+        }
+
+        QString directoryName = name;
+        for (int index = 2; usedNames.contains(directoryName.toLower()); ++index)
+        {
+            directoryName = QString("%1_%2").arg(name).arg(index);
+        }
+
+        usedNames.insert(directoryName.toLower());
+        directoryNames.append(directoryName);
+    }
+
+    return directoryNames;
+}
+
+/**
+ * @brief Sets how many images are generated at the same time.
+ *
+ * @param count The number of concurrently processed images, at least 1.
+ */
+void PuzzleBatchGenerator::setConcurrentImages(int count)
+{
+    concurrentImages = qMax(1, count);
+}
+
+/**
+ * @brief Sets whether every image is cut in tiles from its file, not only images too large to load.
+ *
+ * @param forceTiled True to always use tiled generation.
+ */
+void PuzzleBatchGenerator::setForceTiled(bool forceTiled)
+{
+    this->forceTiled = forceTiled;
+}
+
+/**
+ * @brief Sets whether the pieces are written as one piece pack file instead of PNG files.
+ *
+ * @param writePiecePack True to write pieces.mpcpack.
+ */
+void PuzzleBatchGenerator::setWritePiecePack(bool writePiecePack)
+{
+    this->writePiecePack = writePiecePack;
+}
+
+/**
+ * @brief Generates the puzzles of all images, printing a timing line as each image finishes.
+ *
+ * @param imageFiles The image files to process.
+ * @return The result of every image, in the order of imageFiles.
+ */
+QList<PuzzleBatchGenerator::ImageResult> PuzzleBatchGenerator::run(const QStringList &imageFiles)
+{
+    if (settings.threadCount == 0)
+    {
+        settings.threadCount = qMax(1, QThread::idealThreadCount() / qMin<int>(concurrentImages, qMax<int>(1, imageFiles.count())));
+    }
+
+    QThreadPool imagePool;
+    imagePool.setMaxThreadCount(concurrentImages);
+
+    // Directory names are fixed before any image starts, so concurrent images never write to the same directory.
+    const QStringList directoryNames = outputDirectoryNames(imageFiles);
+    QList<ImageResult> images;
+    for (int i = 0; i < imageFiles.count(); ++i)
+    {
+        ImageResult image;
+        image.fileName = imageFiles.at(i);
+        image.directoryName = directoryNames.at(i);
+        images.append(image);
+    }
+
+    return QtConcurrent::blockingMapped<QList<ImageResult>>(&imagePool, images, [this](const ImageResult &image)
+    {
+        ImageResult result = processImage(image.fileName, image.directoryName);
+        reportResult(result);
+        return result;
+    });
+}
+
+/**
+ * @brief Loads one image, generates its puzzle and writes the preview and pieces.
+ *
+ * @param fileName The image file.
+ * @param directoryName The directory below the output directory the puzzle is written to.
+ * @return The result and timings of the image.
+ */
+PuzzleBatchGenerator::ImageResult PuzzleBatchGenerator::processImage(const QString &fileName, const QString &directoryName) const
+{
+    ImageResult result;
+    result.fileName = fileName;
+    result.directoryName = directoryName;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QImageReader reader(fileName);
+    QSize sourceSize = reader.size();
+    if (forceTiled || PuzzleShapeManager::requiresTiledGeneration(sourceSize))
+    {
+        return processTiledImage(fileName, directoryName, sourceSize);
+    }
+
+    reader.setAutoTransform(true);
+    QImage image = reader.read();
+    if (image.isNull())
+    {
+        result.errorString = reader.errorString();
+        return result;
+    }
+
+    if (image.colorSpace().isValid())
+    {
+        image.convertToColorSpace(QColorSpace::SRgb);
+    }
+
+    if (image.width() / columns < minimumShapeSpacing || image.height() / rows < minimumShapeSpacing)
+    {
+        result.errorString = QString("image of %1x%2 is too small for %3 rows and %4 columns")
+                                 .arg(image.width()).arg(image.height()).arg(rows).arg(columns);
+        return result;
+    }
+    result.loadMilliseconds = timer.restart();
+
+    PuzzleGenerationSettings imageSettings = settings;
+    imageSettings.useAtlas = false;
+
+    PuzzleShapeManager puzzleShapeManager(rows, columns, image, imageSettings);
+    if (!puzzleShapeManager.generate())
+    {
+        result.errorString = puzzleShapeManager.errorString();
+        return result;
+    }
+    result.generateMilliseconds = timer.restart();
+
+    writePuzzle(puzzleShapeManager, result);
+    result.writeMilliseconds = timer.elapsed();
+    return result;
+}
+
+/**
+ * @brief Generates the puzzle of an image too large to load, reading it from the file in tiles.
+ *
+ * @param fileName The image file.
+ * @param directoryName The directory below the output directory the puzzle is written to.
+ * @param sourceSize The size of the stored image.
+ * @return The result and timings of the image, loading is counted as generation.
+ */
+PuzzleBatchGenerator::ImageResult PuzzleBatchGenerator::processTiledImage(const QString &fileName, const QString &directoryName, const QSize &sourceSize) const
+{
+    ImageResult result;
+    result.fileName = fileName;
+    result.directoryName = directoryName;
+
+    if (!sourceSize.isValid())
+    {
+        result.errorString = QImageReader(fileName).errorString();
+        return result;
+    }
+
+    if (sourceSize.width() / columns < minimumShapeSpacing || sourceSize.height() / rows < minimumShapeSpacing)
+    {
+        result.errorString = QString("image of %1x%2 is too small for %3 rows and %4 columns")
+                                 .arg(sourceSize.width()).arg(sourceSize.height()).arg(rows).arg(columns);
+        return result;
+    }
+
+    if (!PuzzleShapeManager::supportsTiledGeneration(fileName))
+    {
+        result.errorString = QString("the %1 decoder cannot read clipped or scaled images, which tiled generation needs")
+                                 .arg(QString::fromLatin1(QImageReader(fileName).format()));
+        return result;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    PuzzleGenerationSettings imageSettings = settings;
+    imageSettings.useAtlas = false;
+
+    PuzzleShapeManager puzzleShapeManager(rows, columns, fileName, imageSettings);
+    if (!puzzleShapeManager.generate())
+    {
+        result.errorString = puzzleShapeManager.errorString();
+        return result;
+    }
+    result.generateMilliseconds = timer.restart();
+
+    writePuzzle(puzzleShapeManager, result);
+    result.writeMilliseconds = timer.elapsed();
+    return result;
+}
+
+/**
+ * @brief Writes the preview and pieces of a generated puzzle below the output directory.
+ *
+ * @param puzzleShapeManager The manager holding the generated puzzle.
+ * @param result The image result, updated with the piece count or an error.
+ */
+void PuzzleBatchGenerator::writePuzzle(const PuzzleShapeManager &puzzleShapeManager, ImageResult &result) const
+{
+    QDir imageDirectory(outputDirectory);
+    const QString &directoryName = result.directoryName;
+    if (!imageDirectory.mkpath(directoryName) || !imageDirectory.cd(directoryName))
+    {
+        result.errorString = QString("cannot create output directory %1").arg(imageDirectory.filePath(directoryName));
+        return;
+    }
+
+    QImage preview = puzzleShapeManager.puzzlePreview();
+    if (preview.isNull())
+    {
+        result.errorString = QString("cannot read the preview of %1").arg(result.fileName);
+        return;
+    }
+
+    if (!preview.save(imageDirectory.filePath("preview.jpg")))
+    {
+        result.errorString = QString("cannot write %1").arg(imageDirectory.filePath("preview.jpg"));
+        return;
+    }
+
+    const QHash<int, QImage> &shapes = puzzleShapeManager.shapeImages();
+    if (writePiecePack)
+    {
+        QString packFile = imageDirectory.filePath("pieces.mpcpack");
+        QString errorString;
+        if (!puzzleShapeManager.writePiecePack(packFile, &errorString))
+        {
+            result.errorString = QString("cannot write %1: %2").arg(packFile, errorString);
+            return;
+        }
+
+        result.pieceCount = shapes.count();
+        result.succeeded = true;
+        return;
+    }
+
+    int idWidth = QString::number(shapes.count()).length();
+    for (auto it = shapes.begin(); it != shapes.end(); ++it)
+    {
+        QString pieceFile = imageDirectory.filePath(QString("piece_%1.png").arg(it.key(), idWidth, 10, QChar('0')));
+        if (!it.value().save(pieceFile))
+        {
+            result.errorString = QString("cannot write %1").arg(pieceFile);
+            return;
+        }
+    }
+
+    result.pieceCount = shapes.count();
+    result.succeeded = true;
+}
+
+/**
+ * @brief Prints the outcome of one image, timings on stdout and errors on stderr.
+ *
+ * @param result The image result.
+ */
+void PuzzleBatchGenerator::reportResult(const ImageResult &result) const
+{
+    QMutexLocker locker(&outputMutex);
+
+    if (result.succeeded)
+    {
+        QTextStream(stdout) << result.fileName << ": " << result.pieceCount << " pieces, load "
+                            << result.loadMilliseconds << " ms, generate " << result.generateMilliseconds
+                            << " ms, write " << result.writeMilliseconds << " ms, written to "
+                            << result.directoryName << Qt::endl;
+    } else
+    {
+        QTextStream(stderr) << result.fileName << ": " << result.errorString << Qt::endl;
+    }
+}
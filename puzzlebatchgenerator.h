@@ -0,0 +1,54 @@
+#ifndef PUZZLEBATCHGENERATOR_H
+#define PUZZLEBATCHGENERATOR_H
+
+#include "puzzlegenerationsettings.h"
+#include <QMutex>
+#include <QObject>
+#include <QStringList>
+
+class PuzzleShapeManager;
+
+class PuzzleBatchGenerator : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct ImageResult
+    {
+        QString fileName;
+        QString directoryName;
+        bool succeeded = false;
+        QString errorString;
+        int pieceCount = 0;
+        qint64 loadMilliseconds = 0;
+        qint64 generateMilliseconds = 0;
+        qint64 writeMilliseconds = 0;
+    };
+
+    explicit PuzzleBatchGenerator(int rows, int columns, const PuzzleGenerationSettings& settings, const QString& outputDirectory, QObject *parent = nullptr);
+
+    static QStringList collectImageFiles(const QStringList& paths);
+    static QStringList outputDirectoryNames(const QStringList& imageFiles);
+
+    void setConcurrentImages(int count);
+    void setForceTiled(bool forceTiled);
+    void setWritePiecePack(bool writePiecePack);
+    QList<ImageResult> run(const QStringList& imageFiles);
+
+private:
+    ImageResult processImage(const QString& fileName, const QString& directoryName) const;
+    ImageResult processTiledImage(const QString& fileName, const QString& directoryName, const QSize& sourceSize) const;
+    void writePuzzle(const PuzzleShapeManager& puzzleShapeManager, ImageResult& result) const;
+    void reportResult(const ImageResult& result) const;
+
+    int rows;
+    int columns;
+    int concurrentImages;
+    bool forceTiled;
+    bool writePiecePack;
+    PuzzleGenerationSettings settings;
+    QString outputDirectory;
+    mutable QMutex outputMutex;
+};
+
+#endif // PUZZLEBATCHGENERATOR_H
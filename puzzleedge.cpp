@@ -0,0 +1,140 @@
+#include "puzzleedge.h"
+#include <QTransform>
+
+/**
+ * @class PuzzleEdge
+ * @brief A compact description of one puzzle edge.
+ *
+ * An edge is kept as the seven points it passes through, the two randomly placed control
+ * points of its base line and a few flags, about 80 bytes instead of a QPainterPath with its
+ * element storage. The path is built on demand from these points; the control points of the
+ * tab are derived from the points the same way each time.
+ *
+ * Edges of the rectangular grid are horizontal or vertical and stored in image coordinates.
+ * Oblique edges are generated as if they ran along the x axis from the origin and carry a
+ * frame, the two image points the x axis is mapped onto when the path is built.
+ */
+
+
+namespace
+{
+/**
+ * @brief Calculates the location of a bezier control points for lines perpendicular to base lines.
+ * @param point1 The starting point of the line.
+ * @param point2 The ending point of the line.
+ * @param distancePoint The distance point from the line.
+ * @return The calculated point for bezier line creation.
+ */
+QPoint calculateBezierPointLocationForPerpendicularLines(const QPoint &point1, const QPoint &point2, const QPoint &distancePoint)
+{
+    QPoint bezierPoint;
+    int randomMidPoint;
+
+    if(point1.y() == point2.y())
+    {
+        randomMidPoint = (point2.x() + point1.x()) / 2;
+
+        bezierPoint.setX(randomMidPoint);
+        bezierPoint.setY(point1.y() - (point1.y() - distancePoint.y()));
+    } else if(point1.x() == point2.x())
+    {
+        randomMidPoint = (point2.y() + point1.y()) / 2;
+
+        bezierPoint.setX(point1.x() - (point1.x() - distancePoint.x()));
+        bezierPoint.setY(randomMidPoint);
+    }
+
+    return bezierPoint;
+}
+
+/**
+ * @brief Calculates the location of a bezier control point for lines making top part of the "tab"/"notch".
+ * @param point1 The starting point of the line.
+ * @param point2 The ending point of the line.
+ * @param distancePoint The distance point from the line.
+ * @return The calculated point for bezier line creation.
+ */
+QPoint calculateBezierPointLocationForLinesBetweenPerpendicularLines(const QPoint &point1, const QPoint &point2, const QPoint &distancePoint)
+{
+    QPoint bezierPoint;
+    int distance;
+
+    if(point1.y() == distancePoint.y())
+    {
+        distance = qAbs(point2.x() - point1.x()) * 0.25;
+        bezierPoint.setX(point1.x()-distance);
+        bezierPoint.setY(point2.y());
+    } else
+    {
+        distance = qAbs(point2.y() - point1.y()) * 0.25;
+        bezierPoint.setX(point2.x());
+        bezierPoint.setY(point1.y()-distance);
+    }
+
+    return bezierPoint;
+}
+}
+
+/**
+ * @brief Checks whether the edge has been generated yet.
+ * @return True for default constructed edges; otherwise, false.
+ */
+bool PuzzleEdge::isNull() const
+{
+    return !(flags & Generated);
+}
+
+/**
+ * @brief Places an edge generated along the x axis between two image points.
+ * @param start The image point the origin is mapped to.
+ * @param end The image point the last control point is mapped to.
+ */
+void PuzzleEdge::setFrame(const QPoint& start, const QPoint& end)
+{
+    frame[0] = start;
+    frame[1] = end;
+    flags |= Framed;
+}
+
+/**
+ * @brief Builds the painter path of the edge.
+ * @return A straight line for border edges, otherwise six quadratic segments forming the tab.
+ */
+QPainterPath PuzzleEdge::toPath() const
+{
+    QPainterPath bezierPath;
+    if (isNull())
+    {
+        return bezierPath;
+    }
+
+    bezierPath.moveTo(controlPoints[0]);
+
+    if (flags & Straight)
+    {
+        bezierPath.lineTo(controlPoints[6]);
+        return bezierPath;
+    }
+
+    const QPoint *p = controlPoints;
+    QPoint p23 = calculateBezierPointLocationForPerpendicularLines(p[1], p[2], p[3]);
+    QPoint p34 = calculateBezierPointLocationForLinesBetweenPerpendicularLines(p[2], p[3], p[4]);
+    QPoint p45 = calculateBezierPointLocationForLinesBetweenPerpendicularLines(p[4], p[3], p[2]);
+    QPoint p56 = calculateBezierPointLocationForPerpendicularLines(p[4], p[5], p[3]);
+
+    bezierPath.quadTo(baseLineControlPoints[0], p[1]);
+    bezierPath.quadTo(p23, p[2]);
+    bezierPath.quadTo(p34, p[3]);
+    bezierPath.quadTo(p45, p[4]);
+    bezierPath.quadTo(p56, p[5]);
+    bezierPath.quadTo(baseLineControlPoints[1], p[6]);
+
+    if ((flags & Framed) && p[6].x() != 0)
+    {
+        QPointF direction = QPointF(frame[1] - frame[0]) / p[6].x();
+        QTransform toImage(direction.x(), direction.y(), -direction.y(), direction.x(), frame[0].x(), frame[0].y());
+        return toImage.map(bezierPath);
+    }
+
+    return bezierPath;
+}
@@ -0,0 +1,28 @@
+#ifndef PUZZLEEDGE_H
+#define PUZZLEEDGE_H
+
+#include <QPainterPath>
+#include <QPoint>
+
+struct PuzzleEdge
+{
+    enum Flag : quint8
+    {
+        Straight = 0x1,
+        Generated = 0x2,
+        Framed = 0x4
+    };
+
+    QPoint controlPoints[7];
+    QPoint baseLineControlPoints[2];
+    QPoint frame[2]; ///< Start and end in the image of a Framed edge, whose points run along the x axis.
+    quint8 flags = 0;
+
+    bool isNull() const;
+    void setFrame(const QPoint& start, const QPoint& end);
+    QPainterPath toPath() const;
+};
+
+Q_DECLARE_TYPEINFO(PuzzleEdge, Q_RELOCATABLE_TYPE);
+
+#endif // PUZZLEEDGE_H
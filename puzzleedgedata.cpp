@@ -1,14 +1,23 @@
 #include "puzzleedgedata.h"
+#include <cmath>
 
 /**
  * @class PuzzleEdgeData
  * @brief The PuzzleEdgeData class manages puzzle edge data.
  *
- * This class is responsible for storing and retrieving puzzle edge information.
+ * This class is responsible for storing and retrieving puzzle edge information. Edges are kept
+ * in one contiguous vector and addressed by the edge ids of the PuzzleLayout. In the rectangular
+ * grid these are first the (rows + 1) * columns horizontal edges row by row, then the
+ * rows * (columns + 1) vertical ones. Edges are stored as compact PuzzleEdge records; their
+ * paths are built on request and the most recently used ones are kept in a small cache, large
+ * enough for a few rows of edges.
  */
 
 
-PuzzleEdgeData::PuzzleEdgeData(QObject *parent)
+PuzzleEdgeData::PuzzleEdgeData(int edgeCount, QObject *parent)
+    : QObject(parent)
+    , edges(edgeCount)
+    , pathCache(qMax(64, 4 * int(std::sqrt(edgeCount))))
 {
 
 }
@@ -16,44 +25,106 @@ PuzzleEdgeData::PuzzleEdgeData(QObject *parent)
 PuzzleEdgeData::~PuzzleEdgeData() {}
 
 /**
-     * @brief Adds an edge with its corresponding path to the data.
+     * @brief Gets the id of a horizontal edge.
      *
-     * @param edge The edge represented by a pair of points.
-     * @param path The QPainterPath corresponding to the edge.
+     * @param row The grid row of the edge, from 0 (top border) to rows (bottom border).
+     * @param column The column of the pieces above and below the edge.
+     * @param columns The number of puzzle columns.
+     * @return The edge id.
      */
-void PuzzleEdgeData::addEdge(const QPair<QPoint, QPoint>& edge, const QPainterPath& path)
+int PuzzleEdgeData::horizontalEdgeId(int row, int column, int columns)
 {
-    edges.insert(edge, path);
+    return row * columns + column;
+}
+
+/**
+     * @brief Gets the id of a vertical edge.
+     *
+     * @param row The row of the pieces left and right of the edge.
+     * @param column The grid column of the edge, from 0 (left border) to columns (right border).
+     * @param rows The number of puzzle rows.
+     * @param columns The number of puzzle columns.
+     * @return The edge id.
+     */
+int PuzzleEdgeData::verticalEdgeId(int row, int column, int rows, int columns)
+{
+    return (rows + 1) * columns + row * (columns + 1) + column;
+}
+
+/**
+     * @brief Stores one edge.
+     *
+     * @param edgeId The edge id.
+     * @param edge The edge record.
+     */
+void PuzzleEdgeData::setEdge(int edgeId, const PuzzleEdge& edge)
+{
+    edges[edgeId] = edge;
+
+    QMutexLocker locker(&pathCacheMutex);
+    pathCache.remove(edgeId);
+}
+
+/**
+     * @brief Replaces all edges at once.
+     *
+     * @param newEdges The records of every edge, indexed by edge id.
+     */
+void PuzzleEdgeData::setEdges(const QVector<PuzzleEdge>& newEdges)
+{
+    Q_ASSERT(newEdges.count() == edges.count());
+    edges = newEdges;
+
+    QMutexLocker locker(&pathCacheMutex);
+    pathCache.clear();
 }
 
 /**
      * @brief Gets all stored edges.
      *
-     * @return A constant reference to the hash containing all edges.
+     * @return A constant reference to the edge records, indexed by edge id.
      */
-const QHash<QPair<QPoint, QPoint>, QPainterPath>& PuzzleEdgeData::getAllEdges() const
+const QVector<PuzzleEdge>& PuzzleEdgeData::getAllEdges() const
 {
     return edges;
 }
 
 /**
-     * @brief Gets the edge path given two points.
+     * @brief Gets the edge record with the given id.
      *
-     * @param point1 The first point of the edge.
-     * @param point2 The second point of the edge.
+     * @param edgeId The edge id.
+     * @return The edge record.
+     */
+const PuzzleEdge& PuzzleEdgeData::getEdge(int edgeId) const
+{
+    return edges[edgeId];
+}
+
+/**
+     * @brief Gets the path of an edge, building it unless it is cached.
+     *
+     * @param edgeId The edge id.
      * @return The QPainterPath corresponding to the edge.
      */
-const QPainterPath PuzzleEdgeData::getEdgeByPoints(const QPoint& point1, const QPoint& point2) const
+QPainterPath PuzzleEdgeData::getEdgePath(int edgeId) const
 {
-    return edges.value(QPair<QPoint, QPoint>(point1, point2));
+    QMutexLocker locker(&pathCacheMutex);
+    if (const QPainterPath *path = pathCache.object(edgeId))
+    {
+        return *path;
+    }
+
+    QPainterPath path = edges[edgeId].toPath();
+    pathCache.insert(edgeId, new QPainterPath(path));
+    return path;
 }
 
 /**
-     * @brief Gets the total count of stored edges.
+     * @brief Gets the total count of edges, border edges included.
      *
      * @return The count of edges.
      */
-int PuzzleEdgeData::count()
+int PuzzleEdgeData::count() const
 {
     return edges.count();
 }
@@ -1,27 +1,36 @@
 #ifndef PUZZLEEDGEDATA_H
 #define PUZZLEEDGEDATA_H
 
+#include "puzzleedge.h"
+#include <QCache>
+#include <QMutex>
 #include <QObject>
-#include <QHash>
 #include <QPainterPath>
-#include <QPoint>
+#include <QVector>
 
 class PuzzleEdgeData : public QObject
 {
     Q_OBJECT
 
 public:
-    explicit PuzzleEdgeData(QObject *parent = nullptr);
+    explicit PuzzleEdgeData(int edgeCount, QObject *parent = nullptr);
     ~PuzzleEdgeData();
 
-    void addEdge(const QPair<QPoint, QPoint>& edge, const QPainterPath& path);
+    static int horizontalEdgeId(int row, int column, int columns);
+    static int verticalEdgeId(int row, int column, int rows, int columns);
 
-    const QHash<QPair<QPoint, QPoint>, QPainterPath>& getAllEdges() const;
-    const QPainterPath getEdgeByPoints(const QPoint& point1, const QPoint& point2) const;
-    int count();
+    void setEdge(int edgeId, const PuzzleEdge& edge);
+    void setEdges(const QVector<PuzzleEdge>& newEdges);
+
+    const QVector<PuzzleEdge>& getAllEdges() const;
+    const PuzzleEdge& getEdge(int edgeId) const;
+    QPainterPath getEdgePath(int edgeId) const;
+    int count() const;
 
 private:
-    QHash<QPair<QPoint, QPoint>, QPainterPath> edges;
+    QVector<PuzzleEdge> edges;
+    mutable QMutex pathCacheMutex;
+    mutable QCache<int, QPainterPath> pathCache;
 };
 
 #endif // PUZZLEEDGEDATA_H
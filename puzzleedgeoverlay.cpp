@@ -0,0 +1,234 @@
+#include "puzzleedgeoverlay.h"
+#include <QPainter>
+#include <QLineF>
+
+/**
+ * @class PuzzleEdgeOverlay
+ * @brief Draws the cutting lines of a puzzle on top of an image at any scale.
+ *
+ * The edges stay in source image coordinates and are stroked with cosmetic pens, so the lines
+ * keep their width at every zoom level. Only the edges crossing the exposed area are turned
+ * into paths, and all of them are stroked as one path.
+ */
+
+
+namespace
+{
+const qreal boundsMargin = 2;
+
+QRectF edgeBoundingRect(const PuzzleEdge& edge)
+{
+    return edge.toPath().controlPointRect().adjusted(-boundsMargin, -boundsMargin, boundsMargin, boundsMargin);
+}
+
+qreal distanceToSegment(const QPointF& point, const QPointF& start, const QPointF& end)
+{
+    QPointF direction = end - start;
+    qreal lengthSquared = QPointF::dotProduct(direction, direction);
+    qreal t = lengthSquared > 0 ? qBound(0.0, QPointF::dotProduct(point - start, direction) / lengthSquared, 1.0) : 0.0;
+
+    return QLineF(point, start + t * direction).length();
+}
+}
+
+/**
+ * @brief Sets the edges to draw.
+ *
+ * @param edges The puzzle edges in source image coordinates.
+ * @param sourceSize The size of the source image the edges belong to.
+ */
+void PuzzleEdgeOverlay::setEdges(const QVector<PuzzleEdge>& edges, const QSize& sourceSize)
+{
+    this->edges = edges;
+    this->sourceSize = sourceSize;
+
+    edgeBounds.clear();
+    edgeBounds.reserve(edges.count());
+    for (const PuzzleEdge &edge : edges)
+    {
+        edgeBounds.append(edgeBoundingRect(edge));
+    }
+}
+
+/**
+ * @brief Replaces one edge, leaving all others untouched.
+ *
+ * @param edgeId The id of the edge.
+ * @param edge The new edge in source image coordinates.
+ */
+void PuzzleEdgeOverlay::setEdge(int edgeId, const PuzzleEdge& edge)
+{
+    if (edgeId < 0 || edgeId >= edges.count())
+    {
+        return;
+    }
+
+    edges[edgeId] = edge;
+    edgeBounds[edgeId] = edgeBoundingRect(edge);
+}
+
+/**
+ * @brief Removes all edges.
+ */
+void PuzzleEdgeOverlay::clear()
+{
+    edges.clear();
+    edgeBounds.clear();
+    sourceSize = QSize();
+}
+
+/**
+ * @brief Checks whether there is anything to draw.
+ *
+ * @return True if no edges are set; otherwise, false.
+ */
+bool PuzzleEdgeOverlay::isEmpty() const
+{
+    return edges.isEmpty() || sourceSize.isEmpty();
+}
+
+/**
+ * @brief Draws the edges crossing the exposed rectangle.
+ *
+ * @param painter The painter to draw with, in target coordinates.
+ * @param targetSize The size the whole source image is shown at.
+ * @param exposedRect The part of the target to draw, in target coordinates.
+ */
+void PuzzleEdgeOverlay::paint(QPainter *painter, const QSize& targetSize, const QRect& exposedRect) const
+{
+    if (isEmpty() || targetSize.isEmpty())
+    {
+        return;
+    }
+
+    qreal scaleX = qreal(targetSize.width()) / sourceSize.width();
+    qreal scaleY = qreal(targetSize.height()) / sourceSize.height();
+    QRectF visibleSource(exposedRect.x() / scaleX, exposedRect.y() / scaleY,
+                         exposedRect.width() / scaleX, exposedRect.height() / scaleY);
+
+    QPainterPath visibleEdges;
+    for (int i = 0; i < edges.count(); ++i)
+    {
+        if (edgeBounds[i].intersects(visibleSource))
+        {
+            visibleEdges.addPath(edges[i].toPath());
+        }
+    }
+
+    if (visibleEdges.isEmpty())
+    {
+        return;
+    }
+
+    QPen blackPen(Qt::black);
+    blackPen.setWidth(3);
+    blackPen.setCosmetic(true);
+    QPen whitePen(Qt::white);
+    whitePen.setWidth(1);
+    whitePen.setCosmetic(true);
+
+    painter->save();
+    painter->setClipRect(exposedRect);
+    painter->scale(scaleX, scaleY);
+    painter->setRenderHint(QPainter::Antialiasing);
+    painter->setBrush(Qt::NoBrush);
+    painter->setPen(blackPen);
+    painter->drawPath(visibleEdges);
+    painter->setPen(whitePen);
+    painter->drawPath(visibleEdges);
+    painter->restore();
+}
+
+/**
+ * @brief Returns the area an edge covers when drawn.
+ *
+ * @param edgeId The id of the edge.
+ * @param targetSize The size the whole source image is shown at.
+ * @return The bounding rectangle of the edge in target coordinates, empty for unknown ids.
+ */
+QRect PuzzleEdgeOverlay::edgeRect(int edgeId, const QSize& targetSize) const
+{
+    if (isEmpty() || edgeId < 0 || edgeId >= edges.count())
+    {
+        return QRect();
+    }
+
+    qreal scaleX = qreal(targetSize.width()) / sourceSize.width();
+    qreal scaleY = qreal(targetSize.height()) / sourceSize.height();
+    const QRectF &bounds = edgeBounds[edgeId];
+
+    return QRectF(bounds.x() * scaleX, bounds.y() * scaleY, bounds.width() * scaleX, bounds.height() * scaleY)
+        .toAlignedRect().adjusted(-2, -2, 2, 2);
+}
+
+/**
+ * @brief Finds the inner edge drawn at a position.
+ *
+ * Border edges are straight and are never reported.
+ *
+ * @param targetPosition The position in target coordinates.
+ * @param targetSize The size the whole source image is shown at.
+ * @param tolerance How far from the line a position may be, in target pixels.
+ * @return The id of the closest edge within the tolerance, or -1 if there is none.
+ */
+int PuzzleEdgeOverlay::edgeAt(const QPoint& targetPosition, const QSize& targetSize, qreal tolerance) const
+{
+    if (isEmpty() || targetSize.isEmpty())
+    {
+        return -1;
+    }
+
+    qreal scaleX = qreal(targetSize.width()) / sourceSize.width();
+    qreal scaleY = qreal(targetSize.height()) / sourceSize.height();
+    QPointF sourcePosition(targetPosition.x() / scaleX, targetPosition.y() / scaleY);
+    qreal sourceTolerance = tolerance / qMin(scaleX, scaleY);
+    QRectF searchRect(sourcePosition.x() - sourceTolerance, sourcePosition.y() - sourceTolerance,
+                      2 * sourceTolerance, 2 * sourceTolerance);
+
+    int closestEdge = -1;
+    qreal closestDistance = sourceTolerance;
+    for (int i = 0; i < edges.count(); ++i)
+    {
+        if (edges[i].isNull() || (edges[i].flags & PuzzleEdge::Straight) || !edgeBounds[i].intersects(searchRect))
+        {
+            continue;
+        }
+
+        const QList<QPolygonF> polygons = edges[i].toPath().toSubpathPolygons();
+        for (const QPolygonF &polygon : polygons)
+        {
+            for (int j = 1; j < polygon.count(); ++j)
+            {
+                qreal distance = distanceToSegment(sourcePosition, polygon[j - 1], polygon[j]);
+                if (distance <= closestDistance)
+                {
+                    closestEdge = i;
+                    closestDistance = distance;
+                }
+            }
+        }
+    }
+
+    return closestEdge;
+}
+
+/**
+ * @brief Returns a copy of an image with the edges drawn on it.
+ *
+ * @param image The image to draw on, the source image or a scaled copy of it.
+ * @param edges The puzzle edges in source image coordinates.
+ * @param sourceSize The size of the source image the edges belong to.
+ * @return The image with the cutting lines.
+ */
+QImage PuzzleEdgeOverlay::render(const QImage& image, const QVector<PuzzleEdge>& edges, const QSize& sourceSize)
+{
+    PuzzleEdgeOverlay overlay;
+    overlay.setEdges(edges, sourceSize);
+
+    QImage preview = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    QPainter painter(&preview);
+    overlay.paint(&painter, preview.size(), preview.rect());
+    painter.end();
+
+    return preview;
+}
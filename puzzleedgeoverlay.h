@@ -0,0 +1,32 @@
+#ifndef PUZZLEEDGEOVERLAY_H
+#define PUZZLEEDGEOVERLAY_H
+
+#include "puzzleedge.h"
+#include <QImage>
+#include <QRectF>
+#include <QSize>
+#include <QVector>
+
+class QPainter;
+
+class PuzzleEdgeOverlay
+{
+public:
+    void setEdges(const QVector<PuzzleEdge>& edges, const QSize& sourceSize);
+    void setEdge(int edgeId, const PuzzleEdge& edge);
+    void clear();
+    bool isEmpty() const;
+
+    void paint(QPainter *painter, const QSize& targetSize, const QRect& exposedRect) const;
+    QRect edgeRect(int edgeId, const QSize& targetSize) const;
+    int edgeAt(const QPoint& targetPosition, const QSize& targetSize, qreal tolerance) const;
+
+    static QImage render(const QImage& image, const QVector<PuzzleEdge>& edges, const QSize& sourceSize);
+
+private:
+    QVector<PuzzleEdge> edges;
+    QVector<QRectF> edgeBounds;
+    QSize sourceSize;
+};
+
+#endif // PUZZLEEDGEOVERLAY_H
@@ -0,0 +1,64 @@
+#include "puzzleedgerandom.h"
+
+/**
+ * @class PuzzleEdgeRandom
+ * @brief Counter based random numbers for the shape of a single puzzle edge.
+ *
+ * The n-th number of an edge is a hash of the puzzle seed, the edge index and n, so an
+ * edge looks the same no matter in which order, on which thread or how often edges are
+ * generated. A puzzle is fully described by its image, grid and seed, plus the reroll count
+ * of every edge that was regenerated on its own.
+ */
+
+
+namespace
+{
+const quint64 goldenGamma = 0x9E3779B97F4A7C15ull;
+const quint64 rerollGamma = 0xD1B54A32D192ED03ull;
+
+quint64 mix(quint64 value)
+{
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+}
+}
+
+/**
+ * @brief Creates the random stream of one edge.
+ *
+ * @param seed The puzzle seed.
+ * @param edgeIndex The index of the edge within the puzzle.
+ * @param reroll How often the edge was regenerated; 0 gives the original shape of the edge.
+ */
+PuzzleEdgeRandom::PuzzleEdgeRandom(quint32 seed, int edgeIndex, quint32 reroll)
+    : key(mix((quint64(seed) << 32 | quint32(edgeIndex)) + goldenGamma) + reroll * rerollGamma)
+    , counter(0)
+{}
+
+/**
+ * @brief Returns the next number of the stream.
+ *
+ * @return A uniformly distributed 32 bit number.
+ */
+quint32 PuzzleEdgeRandom::next()
+{
+    ++counter;
+    return quint32(mix(key + counter * goldenGamma) >> 32);
+}
+
+/**
+ * @brief Returns the next number of the stream reduced to a range.
+ *
+ * @param bound The exclusive upper bound.
+ * @return A number from 0 to bound - 1, or 0 if bound is not positive.
+ */
+int PuzzleEdgeRandom::bounded(int bound)
+{
+    if (bound <= 0)
+    {
+        return 0;
+    }
+
+    return int((quint64(next()) * quint32(bound)) >> 32);
+}
@@ -0,0 +1,19 @@
+#ifndef PUZZLEEDGERANDOM_H
+#define PUZZLEEDGERANDOM_H
+
+#include <QtGlobal>
+
+class PuzzleEdgeRandom
+{
+public:
+    PuzzleEdgeRandom(quint32 seed, int edgeIndex, quint32 reroll = 0);
+
+    quint32 next();
+    int bounded(int bound);
+
+private:
+    quint64 key;
+    quint32 counter;
+};
+
+#endif // PUZZLEEDGERANDOM_H
@@ -0,0 +1,44 @@
+#ifndef PUZZLEGENERATIONSETTINGS_H
+#define PUZZLEGENERATIONSETTINGS_H
+
+#include <QMetaType>
+
+/**
+ * @struct PuzzleGenerationSettings
+ * @brief Options controlling how PuzzleShapeManager generates and cuts puzzle shapes.
+ */
+struct PuzzleGenerationSettings
+{
+    enum CuttingEngine
+    {
+        PerShape,   ///< Clips the source image once per shape.
+        LabelMap    ///< Rasterizes all shapes into one label map and scatters the source in a single pass.
+    };
+
+    enum MaskRasterizer
+    {
+        PainterMask,  ///< Aliased QPainter fill, the same pixels as the original clip path cut.
+        ScanlineMask  ///< PuzzleOutlineRasterizer with exact-area anti-aliasing.
+    };
+
+    enum LayoutType
+    {
+        RectangularLayout, ///< The classic grid of four sided pieces.
+        HexagonalLayout,   ///< Six sided pieces, every other row shifted by half a piece.
+        IrregularLayout    ///< Pieces around randomly displaced grid points, drawn from the seed.
+    };
+
+    int threadCount = 0; ///< Number of cutting threads, 0 uses every available core.
+    CuttingEngine cuttingEngine = PerShape;
+    MaskRasterizer maskRasterizer = PainterMask; ///< How per-piece masks are rasterized, the label map is always anti-aliased.
+    LayoutType layoutType = RectangularLayout; ///< How the image is divided into pieces, rows and columns keep their meaning.
+    quint32 seed = 0; ///< Seed of the edge shapes, equal seeds reproduce the same layout.
+    bool useMaskCache = false; ///< Reuses piece masks of earlier images with the same size, grid and seed.
+    bool useAtlas = false; ///< Packs the pieces into a PuzzlePieceAtlas instead of one pixmap per piece.
+    int tileSize = 4096; ///< Edge length of the source tiles read at once when generating from an image file.
+    qreal flatteningTolerance = 0.2; ///< Largest distance in pixels between a piece outline and the polygon the scanline rasterizer fills.
+};
+
+Q_DECLARE_METATYPE(PuzzleGenerationSettings)
+
+#endif // PUZZLEGENERATIONSETTINGS_H
@@ -0,0 +1,216 @@
+#include "puzzlelabelmapcutter.h"
+#include "maskapplykernel.h"
+#include "puzzleoutlinerasterizer.h"
+#include <QThreadPool>
+#include <QtConcurrent>
+#include <limits>
+
+/**
+ * @class PuzzleLabelMapCutter
+ * @brief Cuts every puzzle shape out of the image in a single sweep over the source pixels.
+ *
+ * All shape outlines are first rasterized with exact-area coverage. The image is then split into
+ * horizontal bands, and each band merges the masks into a label and coverage map of its rows.
+ * Every pixel stores the first shape covering it, and pixels on a seam additionally keep every
+ * further shape sharing them, so corners where three or more pieces meet lose no coverage.
+ * A single pass over the band's source rows then scatters each pixel into the buffers of its
+ * owning shapes, so memory traffic is proportional to the image size instead of the number of
+ * shapes times the image size. Both the outlines and the bands are processed on a thread pool.
+ */
+
+
+namespace
+{
+const int bandsPerThread = 4;
+const int minimumBandHeight = 32;
+
+template <typename Sequence, typename Function>
+void mapInParallel(int threadCount, Sequence items, Function function)
+{
+    if (threadCount == 1)
+    {
+        for (const auto &item : items)
+        {
+            function(item);
+        }
+        return;
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(threadCount);
+    QtConcurrent::blockingMap(&pool, items, function);
+}
+}
+
+/**
+ * @brief Creates a cutter for one image.
+ *
+ * @param image The source image, best already premultiplied so that it is shared instead of converted.
+ * @param flatteningTolerance The largest distance in pixels between an outline and its flattened segments.
+ * @param threadCount The number of threads used for rasterizing and scattering, at least 1.
+ */
+PuzzleLabelMapCutter::PuzzleLabelMapCutter(const QImage &image, qreal flatteningTolerance, int threadCount)
+    : sourceImage(MaskApplyKernel::premultipliedSource(image))
+    , flatteningTolerance(flatteningTolerance)
+    , threadCount(qMax(1, threadCount))
+{}
+
+/**
+ * @brief Returns the largest number of shapes a single label map can hold.
+ *
+ * @return The maximum shape count.
+ */
+int PuzzleLabelMapCutter::maximumShapeCount()
+{
+    return std::numeric_limits<quint16>::max() - 1;
+}
+
+/**
+ * @brief Cuts all puzzle shapes from the image.
+ *
+ * @param puzzleShapes The puzzle shapes keyed by shape index.
+ * @param cuttingRegions The region of the image covered by each shape, keyed by shape index.
+ * @return The premultiplied cut images keyed by shape index, or an empty hash when there are too many shapes.
+ */
+QHash<int, QImage> PuzzleLabelMapCutter::cutShapes(const QHash<int, QPainterPath>& puzzleShapes, const QHash<int, QRect>& cuttingRegions) const
+{
+    QHash<int, QImage> finalShapes;
+    if (puzzleShapes.count() > maximumShapeCount())
+    {
+        return finalShapes;
+    }
+
+    QList<int> shapeKeys = puzzleShapes.keys();
+    std::sort(shapeKeys.begin(), shapeKeys.end());
+
+    QVector<QImage> shapeImages(shapeKeys.count() + 1);
+    QVector<QRect> shapeRegions(shapeKeys.count() + 1);
+    QVector<uchar*> shapeBits(shapeKeys.count() + 1, nullptr);
+    QVector<quint16> shapeLabels;
+
+    for (int i = 0; i < shapeKeys.count(); ++i)
+    {
+        quint16 label = quint16(i + 1);
+        QRect cuttingRegion = cuttingRegions.value(shapeKeys[i]);
+
+        shapeRegions[label] = cuttingRegion;
+        shapeImages[label] = QImage(cuttingRegion.size(), QImage::Format_ARGB32_Premultiplied);
+        shapeImages[label].fill(Qt::transparent);
+        // Taken before the worker threads start, bits() detaches and must not run concurrently.
+        shapeBits[label] = shapeImages[label].bits();
+        shapeLabels.append(label);
+    }
+
+    QVector<QImage> masks(shapeKeys.count() + 1);
+    QImage *maskData = masks.data();
+    mapInParallel(threadCount, shapeLabels, [this, maskData, &puzzleShapes, &shapeKeys, &shapeRegions](quint16 label)
+    {
+        maskData[label] = PuzzleOutlineRasterizer::rasterize(puzzleShapes.value(shapeKeys[label - 1]), shapeRegions[label], flatteningTolerance);
+    });
+
+    int bandCount = threadCount * bandsPerThread;
+    int bandHeight = qMax(minimumBandHeight, (sourceImage.height() + bandCount - 1) / bandCount);
+    QVector<QRect> bands;
+    for (int y = 0; y < sourceImage.height(); y += bandHeight)
+    {
+        bands.append(QRect(0, y, sourceImage.width(), qMin(bandHeight, sourceImage.height() - y)));
+    }
+
+    mapInParallel(threadCount, bands, [this, &masks, &shapeRegions, &shapeImages, &shapeBits](const QRect &band)
+    {
+        cutBand(band, masks, shapeRegions, shapeImages, shapeBits);
+    });
+
+    for (int i = 0; i < shapeKeys.count(); ++i)
+    {
+        finalShapes.insert(shapeKeys[i], shapeImages[i + 1]);
+    }
+
+    return finalShapes;
+}
+
+/**
+ * @brief Merges the shape masks over one band into a label map and scatters the band's pixels.
+ *
+ * Bands cover disjoint rows of the image, so they write disjoint rows of every shape buffer
+ * and can be cut at the same time.
+ *
+ * @param band The rows of the image to cut, spanning its full width.
+ * @param masks The coverage masks of the shapes indexed by label.
+ * @param shapeRegions The image regions of the shapes indexed by label.
+ * @param shapeImages The shape buffers indexed by label.
+ * @param shapeBits The pixel data of the shape buffers indexed by label.
+ */
+void PuzzleLabelMapCutter::cutBand(const QRect& band, const QVector<QImage>& masks, const QVector<QRect>& shapeRegions,
+                                   const QVector<QImage>& shapeImages, const QVector<uchar*>& shapeBits) const
+{
+    int width = band.width();
+    qsizetype pixelCount = qsizetype(width) * band.height();
+    QVector<quint16> labels(pixelCount, 0);
+    QVector<uchar> coverage(pixelCount, 0);
+    QVector<SeamPixel> seamPixels;
+
+    for (int label = 1; label < masks.count(); ++label)
+    {
+        const QRect &region = shapeRegions[label];
+        QRect overlap = region & band;
+        if (overlap.isEmpty())
+        {
+            continue;
+        }
+
+        for (int y = overlap.top(); y <= overlap.bottom(); ++y)
+        {
+            const uchar *maskLine = masks[label].constScanLine(y - region.y()) + (overlap.x() - region.x());
+            qsizetype lineStart = qsizetype(y - band.y()) * width + overlap.x();
+
+            for (int x = 0; x < overlap.width(); ++x)
+            {
+                if (maskLine[x] == 0)
+                {
+                    continue;
+                }
+
+                qsizetype pixelIndex = lineStart + x;
+                if (labels[pixelIndex] == 0)
+                {
+                    labels[pixelIndex] = quint16(label);
+                    coverage[pixelIndex] = maskLine[x];
+                } else
+                {
+                    seamPixels.append(SeamPixel{pixelIndex, quint16(label), maskLine[x]});
+                }
+            }
+        }
+    }
+
+    auto storePixel = [&](quint16 label, int x, int y, QRgb sourcePixel, uchar pixelCoverage)
+    {
+        const QRect &region = shapeRegions[label];
+        QRgb *shapeLine = reinterpret_cast<QRgb*>(shapeBits[label] + qsizetype(y - region.y()) * shapeImages[label].bytesPerLine());
+        shapeLine[x - region.x()] = MaskApplyKernel::multiplyPixel(sourcePixel, pixelCoverage);
+    };
+
+    for (int y = band.top(); y <= band.bottom(); ++y)
+    {
+        const QRgb *sourceLine = reinterpret_cast<const QRgb*>(sourceImage.constScanLine(y));
+        qsizetype lineStart = qsizetype(y - band.y()) * width;
+
+        for (int x = 0; x < width; ++x)
+        {
+            quint16 label = labels[lineStart + x];
+            if (label != 0)
+            {
+                storePixel(label, x, y, sourceLine[x], coverage[lineStart + x]);
+            }
+        }
+    }
+
+    for (const SeamPixel &seam : std::as_const(seamPixels))
+    {
+        int x = int(seam.pixelIndex % width);
+        int y = band.y() + int(seam.pixelIndex / width);
+        const QRgb *sourceLine = reinterpret_cast<const QRgb*>(sourceImage.constScanLine(y));
+        storePixel(seam.label, x, y, sourceLine[x], seam.coverage);
+    }
+}
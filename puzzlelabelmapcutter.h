@@ -0,0 +1,35 @@
+#ifndef PUZZLELABELMAPCUTTER_H
+#define PUZZLELABELMAPCUTTER_H
+
+#include <QHash>
+#include <QImage>
+#include <QPainterPath>
+#include <QRect>
+#include <QVector>
+
+class PuzzleLabelMapCutter
+{
+public:
+    explicit PuzzleLabelMapCutter(const QImage& image, qreal flatteningTolerance = 0.2, int threadCount = 1);
+
+    QHash<int, QImage> cutShapes(const QHash<int, QPainterPath>& puzzleShapes, const QHash<int, QRect>& cuttingRegions) const;
+
+    static int maximumShapeCount();
+
+private:
+    struct SeamPixel
+    {
+        qsizetype pixelIndex;
+        quint16 label;
+        uchar coverage;
+    };
+
+    void cutBand(const QRect& band, const QVector<QImage>& masks, const QVector<QRect>& shapeRegions,
+                 const QVector<QImage>& shapeImages, const QVector<uchar*>& shapeBits) const;
+
+    QImage sourceImage;
+    qreal flatteningTolerance;
+    int threadCount;
+};
+
+#endif // PUZZLELABELMAPCUTTER_H
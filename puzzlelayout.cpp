@@ -0,0 +1,626 @@
+#include "puzzlelayout.h"
+#include "puzzleedgedata.h"
+#include "puzzleedgerandom.h"
+#include <QHash>
+#include <QLineF>
+#include <algorithm>
+#include <cmath>
+
+/**
+ * @class PuzzleLayout
+ * @brief Describes how an image is divided into puzzle cells and which edges they share.
+ *
+ * A layout is a list of cells and a list of edges. Every cell knows the edges around it in
+ * outline order, every edge knows the one or two cells it separates, so neighbours are found
+ * in constant time without any index arithmetic. Cells are also kept in a PuzzleSpatialIndex
+ * for finding the cell at a position. Cell ids are piece ids.
+ *
+ * The rectangular layout is the classic grid, with edge ids following PuzzleEdgeData. The
+ * hexagonal and irregular layouts are Voronoi diagrams of a lattice of sites, offset every other
+ * row for hexagons and randomly displaced within their grid cell for irregular pieces. Each cell
+ * is clipped from the image rectangle by the bisectors of nearby sites only, so building a
+ * layout takes time proportional to the number of cells.
+ */
+
+
+namespace
+{
+enum BorderSide
+{
+    TopBorder = -1,
+    RightBorder = -2,
+    BottomBorder = -3,
+    LeftBorder = -4
+};
+
+struct ClipVertex
+{
+    QPointF point;
+    int side; ///< The site or border that the side starting at this vertex lies on.
+};
+
+const qreal irregularJitter = 0.35;
+
+QPointF circumcenter(const QVector<QPointF>& sites, int first, int second, int third)
+{
+    int ids[3] = {first, second, third};
+    std::sort(ids, ids + 3);
+    QPointF a = sites[ids[0]];
+    QPointF b = sites[ids[1]];
+    QPointF c = sites[ids[2]];
+
+    qreal d = 2 * (a.x() * (b.y() - c.y()) + b.x() * (c.y() - a.y()) + c.x() * (a.y() - b.y()));
+    if (qFuzzyIsNull(d))
+    {
+        return (a + b + c) / 3;
+    }
+
+    qreal aa = a.x() * a.x() + a.y() * a.y();
+    qreal bb = b.x() * b.x() + b.y() * b.y();
+    qreal cc = c.x() * c.x() + c.y() * c.y();
+    return QPointF((aa * (b.y() - c.y()) + bb * (c.y() - a.y()) + cc * (a.y() - b.y())) / d,
+                   (aa * (c.x() - b.x()) + bb * (a.x() - c.x()) + cc * (b.x() - a.x())) / d);
+}
+
+QVector<ClipVertex> clipPolygon(const QVector<ClipVertex>& polygon, const QPointF& site, const QPointF& otherSite, int otherId)
+{
+    QPointF normal = otherSite - site;
+    QPointF middle = (site + otherSite) / 2;
+    auto distance = [&normal, &middle](const QPointF &point)
+    {
+        return QPointF::dotProduct(point - middle, normal);
+    };
+
+    QVector<ClipVertex> clipped;
+    for (int i = 0; i < polygon.count(); ++i)
+    {
+        const ClipVertex &current = polygon[i];
+        const ClipVertex &next = polygon[(i + 1) % polygon.count()];
+        qreal currentDistance = distance(current.point);
+        qreal nextDistance = distance(next.point);
+
+        if (currentDistance <= 0)
+        {
+            clipped.append(ClipVertex{current.point, currentDistance == 0 && nextDistance > 0 ? otherId : current.side});
+        }
+
+        if ((currentDistance < 0 && nextDistance > 0) || (currentDistance > 0 && nextDistance < 0))
+        {
+            qreal t = currentDistance / (currentDistance - nextDistance);
+            QPointF crossing = current.point + (next.point - current.point) * t;
+            clipped.append(ClipVertex{crossing, currentDistance < 0 ? otherId : current.side});
+        }
+    }
+
+    return clipped;
+}
+}
+
+/**
+ * @brief Creates the layout of the given type.
+ *
+ * @param type The kind of layout.
+ * @param imageSize The size of the image being divided.
+ * @param rows Number of cell rows.
+ * @param columns Number of cell columns.
+ * @param seed Seed of the irregular layout.
+ * @return The layout.
+ */
+PuzzleLayout PuzzleLayout::create(PuzzleGenerationSettings::LayoutType type, const QSize& imageSize, int rows, int columns, quint32 seed)
+{
+    switch (type)
+    {
+    case PuzzleGenerationSettings::HexagonalLayout:
+        return hexagonal(imageSize, rows, columns);
+    case PuzzleGenerationSettings::IrregularLayout:
+        return irregular(imageSize, rows, columns, seed);
+    case PuzzleGenerationSettings::RectangularLayout:
+        break;
+    }
+
+    return rectangular(imageSize, rows, columns);
+}
+
+PuzzleLayout::PuzzleLayout(PuzzleGenerationSettings::LayoutType type, const QSize& imageSize, int rows, int columns)
+    : layoutType(type)
+    , imageSize(imageSize)
+    , spacing(imageSize.width() / columns, imageSize.height() / rows)
+{
+    cells.reserve(rows * columns);
+}
+
+/**
+ * @brief Creates the classic rectangular grid.
+ *
+ * Horizontal edges run from left to right and come first, vertical edges run from top to
+ * bottom. Every cell lists its top, right, bottom and left edge.
+ *
+ * @param imageSize The size of the image being divided.
+ * @param rows Number of rows.
+ * @param columns Number of columns.
+ * @return The layout.
+ */
+PuzzleLayout PuzzleLayout::rectangular(const QSize& imageSize, int rows, int columns)
+{
+    PuzzleLayout layout(PuzzleGenerationSettings::RectangularLayout, imageSize, rows, columns);
+
+    int imageWidth = imageSize.width();
+    int imageHeight = imageSize.height();
+    int horizontalSpacing = layout.spacing.width();
+    int verticalSpacing = layout.spacing.height();
+
+    int leftoverXSpacing = imageWidth - horizontalSpacing;
+    int leftoverYSpacing = imageHeight - verticalSpacing;
+
+    QVector<QPoint> points;
+    points.reserve((rows + 1) * (columns + 1));
+    for (int row = 0; row <= rows; ++row)
+    {
+        for (int col = 0; col <= columns; ++col)
+        {
+            int x = col * horizontalSpacing;
+            int y = row * verticalSpacing;
+
+            if(col != 0 && leftoverXSpacing != 0)
+            {
+                x += 1;
+                leftoverXSpacing--;
+            }
+
+
+            if(row != 0 && leftoverYSpacing != 0)
+            {
+                y += 1;
+                leftoverYSpacing--;
+            }
+
+            if(row == rows)
+            {
+                y = imageHeight;
+            }
+
+            if (col == columns)
+            {
+                x = imageWidth;
+            }
+            points.append(QPoint(x, y));
+        }
+    }
+
+    points.last() = QPoint(imageWidth, imageHeight);
+
+    auto point = [&points, columns](int row, int column)
+    {
+        return points[row * (columns + 1) + column];
+    };
+    auto cellId = [rows, columns](int row, int column)
+    {
+        return row >= 0 && row < rows && column >= 0 && column < columns ? row * columns + column : -1;
+    };
+
+    for (int row = 0; row <= rows; ++row)
+    {
+        for (int column = 0; column < columns; ++column)
+        {
+            layout.addEdge(point(row, column), point(row, column + 1), cellId(row - 1, column), cellId(row, column));
+        }
+    }
+
+    for (int row = 0; row < rows; ++row)
+    {
+        for (int column = 0; column <= columns; ++column)
+        {
+            layout.addEdge(point(row, column), point(row + 1, column), cellId(row, column - 1), cellId(row, column));
+        }
+    }
+
+    for (int row = 0; row < rows; ++row)
+    {
+        for (int column = 0; column < columns; ++column)
+        {
+            Cell cell;
+            cell.edges = {{PuzzleEdgeData::horizontalEdgeId(row, column, columns), false},
+                          {PuzzleEdgeData::verticalEdgeId(row, column + 1, rows, columns), false},
+                          {PuzzleEdgeData::horizontalEdgeId(row + 1, column, columns), true},
+                          {PuzzleEdgeData::verticalEdgeId(row, column, rows, columns), true}};
+            cell.polygon << point(row, column) << point(row, column + 1) << point(row + 1, column + 1) << point(row + 1, column);
+            cell.site = QRectF(cell.polygon.boundingRect()).center();
+            layout.cells.append(cell);
+        }
+    }
+
+    layout.buildCellIndex();
+    return layout;
+}
+
+/**
+ * @brief Creates a layout of hexagons, every other row shifted by half a cell.
+ *
+ * Cells on the image border are cut straight along it.
+ *
+ * @param imageSize The size of the image being divided.
+ * @param rows Number of rows.
+ * @param columns Number of cells per row.
+ * @return The layout.
+ */
+PuzzleLayout PuzzleLayout::hexagonal(const QSize& imageSize, int rows, int columns)
+{
+    qreal columnWidth = imageSize.width() / (columns + 0.5);
+    qreal rowHeight = qreal(imageSize.height()) / rows;
+
+    QVector<QPointF> sites;
+    sites.reserve(rows * columns);
+    for (int row = 0; row < rows; ++row)
+    {
+        for (int column = 0; column < columns; ++column)
+        {
+            sites.append(QPointF((column + (row % 2 ? 1.0 : 0.5)) * columnWidth, (row + 0.5) * rowHeight));
+        }
+    }
+
+    return fromSites(PuzzleGenerationSettings::HexagonalLayout, imageSize, rows, columns, sites);
+}
+
+/**
+ * @brief Creates a layout of irregular cells around randomly displaced grid sites.
+ *
+ * Each site lies within its own grid cell, so the cells stay about equally large. The
+ * displacement is drawn from the seed, equal seeds give equal layouts.
+ *
+ * @param imageSize The size of the image being divided.
+ * @param rows Number of rows of sites.
+ * @param columns Number of columns of sites.
+ * @param seed The puzzle seed.
+ * @return The layout.
+ */
+PuzzleLayout PuzzleLayout::irregular(const QSize& imageSize, int rows, int columns, quint32 seed)
+{
+    qreal cellWidth = qreal(imageSize.width()) / columns;
+    qreal cellHeight = qreal(imageSize.height()) / rows;
+
+    QVector<QPointF> sites;
+    sites.reserve(rows * columns);
+    for (int row = 0; row < rows; ++row)
+    {
+        for (int column = 0; column < columns; ++column)
+        {
+            // Negative indices keep the site streams apart from the edge streams of the same seed.
+            PuzzleEdgeRandom random(seed, -1 - (row * columns + column));
+            qreal jitterX = (random.bounded(1001) / 1000.0 - 0.5) * 2 * irregularJitter;
+            qreal jitterY = (random.bounded(1001) / 1000.0 - 0.5) * 2 * irregularJitter;
+            sites.append(QPointF((column + 0.5 + jitterX) * cellWidth, (row + 0.5 + jitterY) * cellHeight));
+        }
+    }
+
+    return fromSites(PuzzleGenerationSettings::IrregularLayout, imageSize, rows, columns, sites);
+}
+
+/**
+ * @brief Returns the kind of the layout.
+ *
+ * @return The layout type.
+ */
+PuzzleGenerationSettings::LayoutType PuzzleLayout::type() const
+{
+    return layoutType;
+}
+
+/**
+ * @brief Returns the average distance between neighbouring cells.
+ *
+ * @return The image size divided by the number of columns and rows.
+ */
+QSize PuzzleLayout::cellSpacing() const
+{
+    return spacing;
+}
+
+/**
+ * @brief Returns the number of cells.
+ *
+ * @return The cell count, equal to the piece count.
+ */
+int PuzzleLayout::cellCount() const
+{
+    return cells.count();
+}
+
+/**
+ * @brief Returns the number of edges, border edges included.
+ *
+ * @return The edge count.
+ */
+int PuzzleLayout::edgeCount() const
+{
+    return edges.count();
+}
+
+/**
+ * @brief Returns a cell.
+ *
+ * @param cellId The cell id.
+ * @return The cell.
+ */
+const PuzzleLayout::Cell& PuzzleLayout::cell(int cellId) const
+{
+    return cells[cellId];
+}
+
+/**
+ * @brief Returns an edge.
+ *
+ * @param edgeId The edge id.
+ * @return The edge.
+ */
+const PuzzleLayout::Edge& PuzzleLayout::edge(int edgeId) const
+{
+    return edges[edgeId];
+}
+
+/**
+ * @brief Checks whether an edge lies on the image border.
+ *
+ * @param edgeId The edge id.
+ * @return True if only one cell touches the edge; otherwise, false.
+ */
+bool PuzzleLayout::isBorderEdge(int edgeId) const
+{
+    return edges[edgeId].cells[1] < 0;
+}
+
+/**
+ * @brief Returns the cells sharing an edge with a cell.
+ *
+ * @param cellId The cell id.
+ * @return The neighbouring cell ids in outline order.
+ */
+QVector<int> PuzzleLayout::neighbours(int cellId) const
+{
+    QVector<int> neighbourIds;
+    for (const CellEdge &cellEdge : cells[cellId].edges)
+    {
+        const Edge &edge = edges[cellEdge.edge];
+        int neighbour = edge.cells[0] == cellId ? edge.cells[1] : edge.cells[0];
+        if (neighbour >= 0)
+        {
+            neighbourIds.append(neighbour);
+        }
+    }
+
+    return neighbourIds;
+}
+
+/**
+ * @brief Finds the cell containing a point.
+ *
+ * Cells are taken with straight edges, so points on a tab may report the neighbouring cell.
+ *
+ * @param point The point in image coordinates.
+ * @return The cell id, or -1 outside the image.
+ */
+int PuzzleLayout::cellAt(const QPoint& point) const
+{
+    const QVector<int> candidates = cellIndex.query(point);
+    for (int cellId : candidates)
+    {
+        if (cells[cellId].polygon.containsPoint(point, Qt::OddEvenFill))
+        {
+            return cellId;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief Builds the Voronoi cells of a lattice of sites, clipped to the image.
+ *
+ * The cell of a site starts as the image rectangle and is clipped by the bisectors of nearby
+ * sites, nearest first, until the remaining sites are too far away to cut it. Each side of the
+ * polygon remembers which site or border it lies on. Corners are then recomputed from the sites
+ * and borders they join, so cells sharing a corner get exactly the same point, and edges between
+ * two cells are created once by the cell with the lower id.
+ *
+ * @param type The kind of layout.
+ * @param imageSize The size of the image being divided.
+ * @param rows Number of rows of sites.
+ * @param columns Number of columns of sites.
+ * @param sites The sites, row by row, each inside the image.
+ * @return The layout.
+ */
+PuzzleLayout PuzzleLayout::fromSites(PuzzleGenerationSettings::LayoutType type, const QSize& imageSize, int rows, int columns,
+                                     const QVector<QPointF>& sites)
+{
+    PuzzleLayout layout(type, imageSize, rows, columns);
+
+    QRect imageRect(QPoint(0, 0), imageSize);
+    int searchRadius = 3 * qMax(layout.spacing.width(), layout.spacing.height());
+    PuzzleSpatialIndex siteIndex(imageRect, qMax(1, qMax(layout.spacing.width(), layout.spacing.height())));
+    for (int i = 0; i < sites.count(); ++i)
+    {
+        siteIndex.insert(i, QRect(sites[i].toPoint(), QSize(1, 1)));
+    }
+
+    QHash<quint64, int> sharedEdges;
+    sharedEdges.reserve(sites.count() * 3);
+
+    for (int site = 0; site < sites.count(); ++site)
+    {
+        const QPointF &center = sites[site];
+
+        QVector<int> nearbySites = siteIndex.query(QRect(center.toPoint() - QPoint(searchRadius, searchRadius),
+                                                         QSize(2 * searchRadius, 2 * searchRadius)));
+        auto squaredDistance = [&sites, &center](int other)
+        {
+            QPointF delta = sites[other] - center;
+            return QPointF::dotProduct(delta, delta);
+        };
+        std::sort(nearbySites.begin(), nearbySites.end(), [&squaredDistance](int first, int second)
+        {
+            return squaredDistance(first) < squaredDistance(second);
+        });
+
+        QVector<ClipVertex> polygon = {{QPointF(0, 0), TopBorder},
+                                       {QPointF(imageSize.width(), 0), RightBorder},
+                                       {QPointF(imageSize.width(), imageSize.height()), BottomBorder},
+                                       {QPointF(0, imageSize.height()), LeftBorder}};
+
+        for (int other : std::as_const(nearbySites))
+        {
+            if (other == site)
+            {
+                continue;
+            }
+
+            qreal largestRadius = 0;
+            for (const ClipVertex &vertex : std::as_const(polygon))
+            {
+                QPointF delta = vertex.point - center;
+                largestRadius = qMax(largestRadius, QPointF::dotProduct(delta, delta));
+            }
+            if (squaredDistance(other) > 4 * largestRadius)
+            {
+                break;
+            }
+
+            polygon = clipPolygon(polygon, center, sites[other], other);
+        }
+
+        int cornerCount = polygon.count();
+        Cell cell;
+        cell.site = center;
+        for (int i = 0; i < cornerCount; ++i)
+        {
+            cell.polygon << siteVertex(sites, imageSize, site, polygon[(i + cornerCount - 1) % cornerCount].side, polygon[i].side);
+        }
+
+        for (int i = 0; i < cornerCount; ++i)
+        {
+            QPoint start = cell.polygon[i];
+            QPoint end = cell.polygon[(i + 1) % cornerCount];
+            int other = polygon[i].side;
+            if (start == end)
+            {
+                continue;
+            }
+
+            if (other < 0)
+            {
+                cell.edges.append(CellEdge{layout.addEdge(start, end, site, -1), false});
+            } else if (site < other)
+            {
+                int edgeId = layout.addEdge(start, end, site, other);
+                sharedEdges.insert(quint64(site) << 32 | quint32(other), edgeId);
+                cell.edges.append(CellEdge{edgeId, false});
+            } else
+            {
+                auto shared = sharedEdges.constFind(quint64(other) << 32 | quint32(site));
+                if (shared != sharedEdges.constEnd())
+                {
+                    cell.edges.append(CellEdge{shared.value(), true});
+                }
+            }
+        }
+
+        layout.cells.append(cell);
+    }
+
+    layout.buildCellIndex();
+    return layout;
+}
+
+/**
+ * @brief Computes a cell corner from the two sides meeting there.
+ *
+ * The result depends only on the set of sites and borders involved, so every cell sharing the
+ * corner gets the same point.
+ *
+ * @param sites All sites.
+ * @param imageSize The size of the image.
+ * @param site The site of the cell.
+ * @param firstSide The site or border of the side ending at the corner.
+ * @param secondSide The site or border of the side starting at the corner.
+ * @return The corner, rounded to whole pixels.
+ */
+QPoint PuzzleLayout::siteVertex(const QVector<QPointF>& sites, const QSize& imageSize, int site, int firstSide, int secondSide)
+{
+    auto borderCoordinate = [&imageSize](int border)
+    {
+        switch (border)
+        {
+        case TopBorder:
+        case LeftBorder:
+            return qreal(0);
+        case RightBorder:
+            return qreal(imageSize.width());
+        default:
+            return qreal(imageSize.height());
+        }
+    };
+    auto isVerticalBorder = [](int border)
+    {
+        return border == LeftBorder || border == RightBorder;
+    };
+
+    if (firstSide >= 0 && secondSide >= 0)
+    {
+        return circumcenter(sites, site, firstSide, secondSide).toPoint();
+    }
+
+    if (firstSide < 0 && secondSide < 0)
+    {
+        int vertical = isVerticalBorder(firstSide) ? firstSide : secondSide;
+        int horizontal = isVerticalBorder(firstSide) ? secondSide : firstSide;
+        return QPointF(borderCoordinate(vertical), borderCoordinate(horizontal)).toPoint();
+    }
+
+    int other = qMax(firstSide, secondSide);
+    int border = qMin(firstSide, secondSide);
+    QPointF first = sites[qMin(site, other)];
+    QPointF second = sites[qMax(site, other)];
+    QPointF middle = (first + second) / 2;
+    QPointF direction(first.y() - second.y(), second.x() - first.x());
+    qreal coordinate = borderCoordinate(border);
+
+    if (isVerticalBorder(border))
+    {
+        qreal t = qFuzzyIsNull(direction.x()) ? 0 : (coordinate - middle.x()) / direction.x();
+        return QPointF(coordinate, middle.y() + t * direction.y()).toPoint();
+    }
+
+    qreal t = qFuzzyIsNull(direction.y()) ? 0 : (coordinate - middle.y()) / direction.y();
+    return QPointF(middle.x() + t * direction.x(), coordinate).toPoint();
+}
+
+/**
+ * @brief Appends an edge.
+ *
+ * @param start The start point.
+ * @param end The end point.
+ * @param firstCell One cell next to the edge, or -1.
+ * @param secondCell The other cell next to the edge, or -1.
+ * @return The id of the new edge.
+ */
+int PuzzleLayout::addEdge(const QPoint& start, const QPoint& end, int firstCell, int secondCell)
+{
+    Edge edge;
+    edge.start = start;
+    edge.end = end;
+    edge.cells[0] = firstCell >= 0 ? firstCell : secondCell;
+    edge.cells[1] = firstCell >= 0 ? secondCell : -1;
+
+    edges.append(edge);
+    return edges.count() - 1;
+}
+
+/**
+ * @brief Puts every cell into the spatial index used by cellAt.
+ */
+void PuzzleLayout::buildCellIndex()
+{
+    cellIndex = PuzzleSpatialIndex(QRect(QPoint(0, 0), imageSize), qMax(spacing.width(), spacing.height()));
+    for (int i = 0; i < cells.count(); ++i)
+    {
+        cellIndex.insert(i, cells[i].polygon.boundingRect());
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef PUZZLELAYOUT_H
+#define PUZZLELAYOUT_H
+
+#include "puzzlegenerationsettings.h"
+#include "puzzlespatialindex.h"
+#include <QPoint>
+#include <QPointF>
+#include <QPolygon>
+#include <QSize>
+#include <QVector>
+
+class PuzzleLayout
+{
+public:
+    struct Edge
+    {
+        QPoint start;
+        QPoint end;
+        int cells[2] = {-1, -1}; ///< The cells on both sides, the second one is -1 on the image border.
+    };
+
+    struct CellEdge
+    {
+        int edge;
+        bool reversed; ///< True if the cell runs along the edge from its end to its start.
+    };
+
+    struct Cell
+    {
+        QVector<CellEdge> edges; ///< The edges around the cell, in outline order.
+        QPolygon polygon;        ///< The corners of the cell, edges taken as straight lines.
+        QPointF site;
+    };
+
+    PuzzleLayout() = default;
+
+    static PuzzleLayout create(PuzzleGenerationSettings::LayoutType type, const QSize& imageSize, int rows, int columns, quint32 seed);
+    static PuzzleLayout rectangular(const QSize& imageSize, int rows, int columns);
+    static PuzzleLayout hexagonal(const QSize& imageSize, int rows, int columns);
+    static PuzzleLayout irregular(const QSize& imageSize, int rows, int columns, quint32 seed);
+
+    PuzzleGenerationSettings::LayoutType type() const;
+    QSize cellSpacing() const;
+    int cellCount() const;
+    int edgeCount() const;
+    const Cell& cell(int cellId) const;
+    const Edge& edge(int edgeId) const;
+    bool isBorderEdge(int edgeId) const;
+    QVector<int> neighbours(int cellId) const;
+    int cellAt(const QPoint& point) const;
+
+private:
+    PuzzleLayout(PuzzleGenerationSettings::LayoutType type, const QSize& imageSize, int rows, int columns);
+
+    static PuzzleLayout fromSites(PuzzleGenerationSettings::LayoutType type, const QSize& imageSize, int rows, int columns,
+                                  const QVector<QPointF>& sites);
+    static QPoint siteVertex(const QVector<QPointF>& sites, const QSize& imageSize, int site, int firstSide, int secondSide);
+    int addEdge(const QPoint& start, const QPoint& end, int firstCell, int secondCell);
+    void buildCellIndex();
+
+    PuzzleGenerationSettings::LayoutType layoutType = PuzzleGenerationSettings::RectangularLayout;
+    QSize imageSize;
+    QSize spacing;
+    QVector<Cell> cells;
+    QVector<Edge> edges;
+    PuzzleSpatialIndex cellIndex;
+};
+
+#endif // PUZZLELAYOUT_H
@@ -0,0 +1,154 @@
+#include "puzzlemaskcache.h"
+#include "maskapplykernel.h"
+#include <QMutexLocker>
+
+/**
+ * @class PuzzleMaskCache
+ * @brief Process-wide cache of piece alpha masks for a puzzle layout.
+ *
+ * A layout is identified by the image size, the grid, the layout type and the seed used to generate its edges.
+ * Images cut with a cached layout skip edge generation and clip path rasterization entirely,
+ * every piece is produced by multiplying the source region with its stored mask.
+ * The cache is safe to use from several threads.
+ */
+
+
+namespace
+{
+const qsizetype bytesPerCostUnit = 1024;
+const qsizetype defaultMaximumBytes = qsizetype(512) * 1024 * 1024;
+}
+
+bool PuzzleMaskLayoutKey::operator==(const PuzzleMaskLayoutKey &other) const
+{
+    return imageSize == other.imageSize && rows == other.rows && columns == other.columns && seed == other.seed
+           && flatteningTolerance == other.flatteningTolerance && maskRasterizer == other.maskRasterizer
+           && layoutType == other.layoutType;
+}
+
+size_t qHash(const PuzzleMaskLayoutKey &key, size_t seed)
+{
+    return qHashMulti(seed, key.imageSize.width(), key.imageSize.height(), key.rows, key.columns, key.seed, key.flatteningTolerance,
+                      int(key.maskRasterizer), int(key.layoutType));
+}
+
+/**
+ * @brief Returns the number of bytes held by the masks of the layout.
+ *
+ * @return The mask memory in bytes.
+ */
+qsizetype PuzzleMaskLayout::byteCount() const
+{
+    qsizetype bytes = 0;
+    for (const QImage &mask : masks)
+    {
+        bytes += mask.sizeInBytes();
+    }
+
+    return bytes;
+}
+
+PuzzleMaskCache::PuzzleMaskCache()
+    : layouts(defaultMaximumBytes / bytesPerCostUnit)
+{}
+
+/**
+ * @brief Returns the shared cache instance.
+ *
+ * @return The process-wide mask cache.
+ */
+PuzzleMaskCache &PuzzleMaskCache::instance()
+{
+    static PuzzleMaskCache cache;
+    return cache;
+}
+
+/**
+ * @brief Looks up a cached layout.
+ *
+ * @param key The layout key.
+ * @param layout Receives a copy of the cached layout, the masks themselves are implicitly shared.
+ * @return True if the layout was cached; otherwise, false.
+ */
+bool PuzzleMaskCache::findLayout(const PuzzleMaskLayoutKey &key, PuzzleMaskLayout &layout)
+{
+    QMutexLocker locker(&mutex);
+
+    PuzzleMaskLayout *cachedLayout = layouts.object(key);
+    if (!cachedLayout)
+    {
+        return false;
+    }
+
+    layout = *cachedLayout;
+    return true;
+}
+
+/**
+ * @brief Stores a layout, evicting the least recently used layouts when over budget.
+ *
+ * @param key The layout key.
+ * @param layout The layout to store.
+ */
+void PuzzleMaskCache::insertLayout(const PuzzleMaskLayoutKey &key, const PuzzleMaskLayout &layout)
+{
+    QMutexLocker locker(&mutex);
+
+    qsizetype cost = qMax<qsizetype>(1, layout.byteCount() / bytesPerCostUnit);
+    layouts.insert(key, new PuzzleMaskLayout(layout), cost);
+}
+
+/**
+ * @brief Sets the memory budget of the cache.
+ *
+ * @param bytes The maximum number of mask bytes kept in the cache.
+ */
+void PuzzleMaskCache::setMaximumBytes(qsizetype bytes)
+{
+    QMutexLocker locker(&mutex);
+    layouts.setMaxCost(bytes / bytesPerCostUnit);
+}
+
+/**
+ * @brief Removes one cached layout.
+ *
+ * @param key The layout key.
+ */
+void PuzzleMaskCache::removeLayout(const PuzzleMaskLayoutKey& key)
+{
+    QMutexLocker locker(&mutex);
+    layouts.remove(key);
+}
+
+/**
+ * @brief Removes every cached layout.
+ */
+void PuzzleMaskCache::clear()
+{
+    QMutexLocker locker(&mutex);
+    layouts.clear();
+}
+
+/**
+ * @brief Produces a piece by multiplying a region of the source image with its mask.
+ *
+ * @param sourceImage The source image in Format_RGB32 or Format_ARGB32_Premultiplied.
+ * @param mask The Format_Alpha8 mask of the piece, sized like the cutting region.
+ * @param cuttingRegion The region of the source image covered by the mask.
+ * @return The premultiplied piece image.
+ */
+QImage PuzzleMaskCache::applyMask(const QImage &sourceImage, const QImage &mask, const QRect &cuttingRegion)
+{
+    QImage shape(cuttingRegion.size(), QImage::Format_ARGB32_Premultiplied);
+
+    for (int y = 0; y < cuttingRegion.height(); ++y)
+    {
+        const QRgb *sourceLine = reinterpret_cast<const QRgb*>(sourceImage.constScanLine(cuttingRegion.y() + y)) + cuttingRegion.x();
+        const uchar *maskLine = mask.constScanLine(y);
+        QRgb *shapeLine = reinterpret_cast<QRgb*>(shape.scanLine(y));
+
+        MaskApplyKernel::applyMask(sourceLine, maskLine, shapeLine, cuttingRegion.width());
+    }
+
+    return shape;
+}
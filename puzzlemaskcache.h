@@ -0,0 +1,58 @@
+#ifndef PUZZLEMASKCACHE_H
+#define PUZZLEMASKCACHE_H
+
+#include "puzzleedge.h"
+#include "puzzlegenerationsettings.h"
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QRect>
+#include <QSize>
+#include <QVector>
+
+struct PuzzleMaskLayoutKey
+{
+    QSize imageSize;
+    int rows = 0;
+    int columns = 0;
+    quint32 seed = 0;
+    qreal flatteningTolerance = 0;
+    PuzzleGenerationSettings::MaskRasterizer maskRasterizer = PuzzleGenerationSettings::PainterMask;
+    PuzzleGenerationSettings::LayoutType layoutType = PuzzleGenerationSettings::RectangularLayout;
+
+    bool operator==(const PuzzleMaskLayoutKey& other) const;
+};
+
+size_t qHash(const PuzzleMaskLayoutKey& key, size_t seed = 0);
+
+struct PuzzleMaskLayout
+{
+    QHash<int, QImage> masks;
+    QHash<int, QRect> cuttingRegions;
+    QVector<PuzzleEdge> edges;
+
+    qsizetype byteCount() const;
+};
+
+class PuzzleMaskCache
+{
+public:
+    static PuzzleMaskCache& instance();
+
+    bool findLayout(const PuzzleMaskLayoutKey& key, PuzzleMaskLayout& layout);
+    void insertLayout(const PuzzleMaskLayoutKey& key, const PuzzleMaskLayout& layout);
+    void removeLayout(const PuzzleMaskLayoutKey& key);
+    void setMaximumBytes(qsizetype bytes);
+    void clear();
+
+    static QImage applyMask(const QImage& sourceImage, const QImage& mask, const QRect& cuttingRegion);
+
+private:
+    PuzzleMaskCache();
+
+    QMutex mutex;
+    QCache<PuzzleMaskLayoutKey, PuzzleMaskLayout> layouts;
+};
+
+#endif // PUZZLEMASKCACHE_H
@@ -0,0 +1,321 @@
+#include "puzzleoutlinerasterizer.h"
+#include <algorithm>
+#include <cmath>
+
+/**
+ * @class PuzzleOutlineRasterizer
+ * @brief Rasterizes closed piece outlines into anti-aliased 8-bit masks.
+ *
+ * Curves are flattened adaptively, so no line segment strays further than the tolerance from
+ * its curve. The segments are clipped to the mask horizontally and kept in an edge table sorted
+ * by their top. Each row is then filled from its active edges only: every edge adds the exact
+ * area it covers to a row of accumulators, and a running sum over the row turns these into the
+ * coverage of each pixel. Memory besides the mask is one row of floats, and no QPainter clip
+ * or path joining is involved.
+ *
+ * Coverage follows the non-zero fill rule. Piece outlines never cross themselves, so this matches
+ * the odd-even rule QPainterPath uses by default.
+ */
+
+
+namespace
+{
+const int maximumCurveSegments = 256;
+}
+
+/**
+ * @brief Creates a rasterizer for one mask.
+ *
+ * @param region The area of the image covered by the mask, paths are given in image coordinates.
+ * @param tolerance The largest distance in pixels between a curve and its flattened segments.
+ */
+PuzzleOutlineRasterizer::PuzzleOutlineRasterizer(const QRect& region, qreal tolerance)
+    : region(region)
+    , tolerance(qMax(tolerance, qreal(0.01)))
+{}
+
+/**
+ * @brief Adds the outline of a shape. Every subpath is closed.
+ *
+ * @param path The outline in image coordinates.
+ */
+void PuzzleOutlineRasterizer::addPath(const QPainterPath& path)
+{
+    QPointF offset = region.topLeft();
+    QPointF subpathStart;
+    QPointF current;
+
+    for (int i = 0; i < path.elementCount(); ++i)
+    {
+        const QPainterPath::Element &element = path.elementAt(i);
+        QPointF point = QPointF(element) - offset;
+
+        switch (element.type)
+        {
+        case QPainterPath::MoveToElement:
+            addLine(current, subpathStart);
+            subpathStart = point;
+            current = point;
+            break;
+        case QPainterPath::LineToElement:
+            addLine(current, point);
+            current = point;
+            break;
+        case QPainterPath::CurveToElement:
+        {
+            QPointF control2 = QPointF(path.elementAt(i + 1)) - offset;
+            QPointF end = QPointF(path.elementAt(i + 2)) - offset;
+            addCurve(current, point, control2, end);
+            current = end;
+            i += 2;
+            break;
+        }
+        case QPainterPath::CurveToDataElement:
+            break;
+        }
+    }
+
+    addLine(current, subpathStart);
+}
+
+/**
+ * @brief Rasterizes all added outlines.
+ *
+ * @return The Format_Alpha8 mask covering the region.
+ */
+QImage PuzzleOutlineRasterizer::rasterize() const
+{
+    QImage mask(region.size(), QImage::Format_Alpha8);
+    mask.fill(0);
+
+    if (edges.isEmpty() || mask.isNull())
+    {
+        return mask;
+    }
+
+    QVector<int> edgeTable(edges.count());
+    for (int i = 0; i < edges.count(); ++i)
+    {
+        edgeTable[i] = i;
+    }
+    std::sort(edgeTable.begin(), edgeTable.end(), [this](int first, int second)
+    {
+        return edges[first].topY < edges[second].topY;
+    });
+
+    int width = mask.width();
+    QVector<float> accumulation(width + 2, 0.0f);
+    QVector<int> activeEdges;
+    int nextEdge = 0;
+
+    for (int y = 0; y < mask.height(); ++y)
+    {
+        while (nextEdge < edgeTable.count() && edges[edgeTable[nextEdge]].topY < y + 1)
+        {
+            activeEdges.append(edgeTable[nextEdge++]);
+        }
+
+        activeEdges.removeIf([this, y](int edge)
+        {
+            return edges[edge].bottomY <= y;
+        });
+
+        if (activeEdges.isEmpty())
+        {
+            continue;
+        }
+
+        for (int edge : std::as_const(activeEdges))
+        {
+            accumulateRow(edges[edge], y, accumulation.data());
+        }
+
+        uchar *maskLine = mask.scanLine(y);
+        float coverage = 0;
+        for (int x = 0; x < width; ++x)
+        {
+            coverage += accumulation[x];
+            accumulation[x] = 0;
+            maskLine[x] = uchar(qMin(std::fabs(coverage), 1.0f) * 255.0f + 0.5f);
+        }
+        accumulation[width] = 0;
+        accumulation[width + 1] = 0;
+    }
+
+    return mask;
+}
+
+/**
+ * @brief Rasterizes a single outline.
+ *
+ * @param outline The closed outline in image coordinates.
+ * @param region The area of the image covered by the mask.
+ * @param tolerance The largest distance in pixels between a curve and its flattened segments.
+ * @return The Format_Alpha8 mask covering the region.
+ */
+QImage PuzzleOutlineRasterizer::rasterize(const QPainterPath& outline, const QRect& region, qreal tolerance)
+{
+    PuzzleOutlineRasterizer rasterizer(region, tolerance);
+    rasterizer.addPath(outline);
+    return rasterizer.rasterize();
+}
+
+/**
+ * @brief Flattens a cubic Bezier curve into line segments.
+ *
+ * QPainterPath stores quadratic curves as cubic ones, so this covers both. The segment count
+ * follows from the largest second difference of the control points, which bounds how far a
+ * chord of the curve can stray from it.
+ *
+ * @param p0 The start point.
+ * @param p1 The first control point.
+ * @param p2 The second control point.
+ * @param p3 The end point.
+ */
+void PuzzleOutlineRasterizer::addCurve(const QPointF& p0, const QPointF& p1, const QPointF& p2, const QPointF& p3)
+{
+    QPointF difference1 = p0 - 2 * p1 + p2;
+    QPointF difference2 = p1 - 2 * p2 + p3;
+    qreal curvature = qMax(std::hypot(difference1.x(), difference1.y()), std::hypot(difference2.x(), difference2.y()));
+    int segments = qBound(1, int(std::ceil(std::sqrt(0.75 * curvature / tolerance))), maximumCurveSegments);
+
+    QPointF previous = p0;
+    for (int i = 1; i <= segments; ++i)
+    {
+        qreal t = qreal(i) / segments;
+        qreal u = 1 - t;
+        QPointF point = u * u * u * p0 + 3 * u * u * t * p1 + 3 * u * t * t * p2 + t * t * t * p3;
+        addLine(previous, point);
+        previous = point;
+    }
+}
+
+/**
+ * @brief Adds a line segment, splitting it where it leaves the mask on the left or right.
+ *
+ * Parts outside the mask are moved onto its border, so they still add their winding to the
+ * pixels beside them.
+ *
+ * @param from The start point in mask coordinates.
+ * @param to The end point in mask coordinates.
+ */
+void PuzzleOutlineRasterizer::addLine(const QPointF& from, const QPointF& to)
+{
+    if (from.y() == to.y())
+    {
+        return;
+    }
+
+    qreal splits[4] = {0, 1, 1, 1};
+    int splitCount = 1;
+    qreal deltaX = to.x() - from.x();
+    if (deltaX != 0)
+    {
+        for (qreal border : {qreal(0), qreal(region.width())})
+        {
+            qreal t = (border - from.x()) / deltaX;
+            if (t > 0 && t < 1)
+            {
+                splits[splitCount++] = t;
+            }
+        }
+    }
+    splits[splitCount++] = 1;
+    std::sort(splits, splits + splitCount);
+
+    for (int i = 1; i < splitCount; ++i)
+    {
+        addClampedLine(from + (to - from) * splits[i - 1], from + (to - from) * splits[i]);
+    }
+}
+
+/**
+ * @brief Stores a line segment in the edge table, moved horizontally into the mask.
+ *
+ * @param from The start point in mask coordinates.
+ * @param to The end point in mask coordinates.
+ */
+void PuzzleOutlineRasterizer::addClampedLine(QPointF from, QPointF to)
+{
+    float direction = 1;
+    if (from.y() == to.y() || qMax(from.y(), to.y()) <= 0 || qMin(from.y(), to.y()) >= region.height())
+    {
+        return;
+    }
+
+    from.setX(qBound(qreal(0), from.x(), qreal(region.width())));
+    to.setX(qBound(qreal(0), to.x(), qreal(region.width())));
+
+    if (from.y() > to.y())
+    {
+        std::swap(from, to);
+        direction = -direction;
+    }
+
+    edges.append(Edge{float(from.x()), float(from.y()), float(to.y()), float((to.x() - from.x()) / (to.y() - from.y())), direction});
+}
+
+/**
+ * @brief Adds the exact area an edge covers within one row to the accumulators.
+ *
+ * Each accumulator holds the change of coverage from the previous pixel, so the running sum
+ * over the row gives the coverage of each pixel.
+ *
+ * @param edge The edge crossing the row.
+ * @param y The row.
+ * @param accumulation The accumulators of the row, two more than the mask is wide.
+ */
+void PuzzleOutlineRasterizer::accumulateRow(const Edge& edge, int y, float *accumulation) const
+{
+    float rowTop = qMax(float(y), edge.topY);
+    float rowBottom = qMin(float(y + 1), edge.bottomY);
+    float deltaY = rowBottom - rowTop;
+    if (deltaY <= 0)
+    {
+        return;
+    }
+
+    float width = region.width();
+    float x = qBound(0.0f, edge.topX + (rowTop - edge.topY) * edge.dxdy, width);
+    float nextX = qBound(0.0f, x + edge.dxdy * deltaY, width);
+    float area = deltaY * edge.direction;
+
+    float x0 = qMin(x, nextX);
+    float x1 = qMax(x, nextX);
+    float x0Floor = std::floor(x0);
+    float x1Ceil = std::ceil(x1);
+    int x0Index = int(x0Floor);
+    int x1Index = int(x1Ceil);
+
+    if (x1Index <= x0Index + 1)
+    {
+        // The edge stays within one pixel column: split the area at its mean position.
+        float middle = 0.5f * (x + nextX) - x0Floor;
+        accumulation[x0Index] += area - area * middle;
+        accumulation[x0Index + 1] += area * middle;
+        return;
+    }
+
+    float slope = 1.0f / (x1 - x0);
+    float x0Fraction = x0 - x0Floor;
+    float firstArea = 0.5f * slope * (1.0f - x0Fraction) * (1.0f - x0Fraction);
+    float x1Fraction = x1 - x1Ceil + 1.0f;
+    float lastArea = 0.5f * slope * x1Fraction * x1Fraction;
+
+    accumulation[x0Index] += area * firstArea;
+    if (x1Index == x0Index + 2)
+    {
+        accumulation[x0Index + 1] += area * (1.0f - firstArea - lastArea);
+    } else
+    {
+        float secondArea = slope * (1.5f - x0Fraction);
+        accumulation[x0Index + 1] += area * (secondArea - firstArea);
+        for (int column = x0Index + 2; column < x1Index - 1; ++column)
+        {
+            accumulation[column] += area * slope;
+        }
+        float areaBeforeLast = secondArea + (x1Index - x0Index - 3) * slope;
+        accumulation[x1Index - 1] += area * (1.0f - areaBeforeLast - lastArea);
+    }
+    accumulation[x1Index] += area * lastArea;
+}
@@ -0,0 +1,42 @@
+#ifndef PUZZLEOUTLINERASTERIZER_H
+#define PUZZLEOUTLINERASTERIZER_H
+
+#include <QImage>
+#include <QPainterPath>
+#include <QPointF>
+#include <QRect>
+#include <QVector>
+
+class PuzzleOutlineRasterizer
+{
+public:
+    static constexpr qreal defaultTolerance = 0.2;
+
+    explicit PuzzleOutlineRasterizer(const QRect& region, qreal tolerance = defaultTolerance);
+
+    void addPath(const QPainterPath& path);
+    QImage rasterize() const;
+
+    static QImage rasterize(const QPainterPath& outline, const QRect& region, qreal tolerance = defaultTolerance);
+
+private:
+    struct Edge
+    {
+        float topX;
+        float topY;
+        float bottomY;
+        float dxdy;
+        float direction;
+    };
+
+    void addCurve(const QPointF& p0, const QPointF& p1, const QPointF& p2, const QPointF& p3);
+    void addLine(const QPointF& from, const QPointF& to);
+    void addClampedLine(QPointF from, QPointF to);
+    void accumulateRow(const Edge& edge, int y, float *accumulation) const;
+
+    QRect region;
+    qreal tolerance;
+    QVector<Edge> edges;
+};
+
+#endif // PUZZLEOUTLINERASTERIZER_H
@@ -0,0 +1,308 @@
+#include "puzzlepieceatlas.h"
+#include <QPainter>
+#include <algorithm>
+
+/**
+ * @class PuzzlePieceAtlas
+ * @brief Packs all puzzle pieces into a few large pages with a per-piece rectangle table.
+ *
+ * Instead of one separately allocated pixmap per piece, views draw sub-rectangles of the
+ * shared pages. Pages are built from images, so packing can run on worker threads, and
+ * each page is turned into a QPixmap on the GUI thread the first time it is drawn.
+ */
+
+
+namespace
+{
+const int piecePadding = 1;
+}
+
+/**
+ * @brief Packs the pieces into pages using shelf packing, tallest pieces first.
+ *
+ * @param pieces The piece images keyed by piece id.
+ * @param pageSize The size of a page, pieces larger than a page get a page of their own.
+ * @return The packed atlas.
+ */
+QSharedPointer<PuzzlePieceAtlas> PuzzlePieceAtlas::build(const QHash<int, QImage>& pieces, const QSize& pageSize)
+{
+    QSharedPointer<PuzzlePieceAtlas> atlas(new PuzzlePieceAtlas());
+
+    QList<int> pieceIds = pieces.keys();
+    std::sort(pieceIds.begin(), pieceIds.end(), [&pieces](int first, int second)
+    {
+        int firstHeight = pieces.value(first).height();
+        int secondHeight = pieces.value(second).height();
+        return firstHeight != secondHeight ? firstHeight > secondHeight : first < second;
+    });
+
+    QVector<QSize> usedPageSizes;
+    int page = -1;
+    int shelfX = 0;
+    int shelfY = 0;
+    int shelfHeight = 0;
+
+    for (int pieceId : pieceIds)
+    {
+        QSize size = pieces.value(pieceId).size();
+        QSize paddedSize = size + QSize(piecePadding, piecePadding);
+
+        if (paddedSize.width() > pageSize.width() || paddedSize.height() > pageSize.height())
+        {
+            usedPageSizes.append(size);
+            atlas->locations.insert(pieceId, PieceLocation{int(usedPageSizes.count()) - 1, QRect(QPoint(0, 0), size)});
+            continue;
+        }
+
+        if (page >= 0 && shelfX + paddedSize.width() > pageSize.width())
+        {
+            shelfX = 0;
+            shelfY += shelfHeight;
+            shelfHeight = 0;
+        }
+
+        if (page < 0 || shelfY + paddedSize.height() > pageSize.height())
+        {
+            usedPageSizes.append(QSize(0, 0));
+            page = int(usedPageSizes.count()) - 1;
+            shelfX = 0;
+            shelfY = 0;
+            shelfHeight = 0;
+        }
+
+        atlas->locations.insert(pieceId, PieceLocation{page, QRect(QPoint(shelfX, shelfY), size)});
+
+        shelfX += paddedSize.width();
+        shelfHeight = qMax(shelfHeight, paddedSize.height());
+        usedPageSizes[page] = usedPageSizes[page].expandedTo(QSize(shelfX, shelfY + shelfHeight));
+    }
+
+    for (const QSize &usedSize : std::as_const(usedPageSizes))
+    {
+        QImage pageImage(usedSize, QImage::Format_ARGB32_Premultiplied);
+        pageImage.fill(Qt::transparent);
+        atlas->pageImages.append(pageImage);
+    }
+
+    atlas->pagePieceCounts.fill(0, atlas->pageImages.count());
+    QVector<QPainter*> painters(atlas->pageImages.count(), nullptr);
+    for (auto it = atlas->locations.constBegin(); it != atlas->locations.constEnd(); ++it)
+    {
+        ++atlas->pagePieceCounts[it->page];
+        QPainter *&painter = painters[it->page];
+        if (!painter)
+        {
+            painter = new QPainter(&atlas->pageImages[it->page]);
+            painter->setCompositionMode(QPainter::CompositionMode_Source);
+        }
+        painter->drawImage(it->rect.topLeft(), pieces.value(it.key()));
+    }
+    qDeleteAll(painters);
+
+    atlas->pagePixmaps.resize(atlas->pageImages.count());
+    return atlas;
+}
+
+/**
+ * @brief Wraps the pieces without packing them, every piece becomes a page of its own.
+ *
+ * The images are shared, not copied, which suits pieces that already live in memory mapped
+ * storage such as a PuzzlePiecePack. Each pixmap is still created on first use only.
+ *
+ * @param pieces The piece images keyed by piece id.
+ * @return The atlas.
+ */
+QSharedPointer<PuzzlePieceAtlas> PuzzlePieceAtlas::fromPieces(const QHash<int, QImage>& pieces)
+{
+    QSharedPointer<PuzzlePieceAtlas> atlas(new PuzzlePieceAtlas());
+
+    atlas->pageImages.reserve(pieces.count());
+    for (auto it = pieces.constBegin(); it != pieces.constEnd(); ++it)
+    {
+        atlas->locations.insert(it.key(), PieceLocation{int(atlas->pageImages.count()), it.value().rect()});
+        atlas->pageImages.append(it.value());
+    }
+
+    atlas->pagePixmaps.resize(atlas->pageImages.count());
+    atlas->pagePieceCounts.fill(1, atlas->pageImages.count());
+    return atlas;
+}
+
+/**
+ * @brief Replaces the image of one piece.
+ *
+ * A piece alone on its page gets the new image as its page. On a shared page the new image is
+ * drawn over the old one when it fits, otherwise it gets a page of its own and the old space
+ * stays unused. Nothing else is repacked, and repeated replacements of a piece reuse its page.
+ * Must be called on the GUI thread when the page may already be uploaded.
+ *
+ * @param pieceId The piece id.
+ * @param image The new premultiplied piece image.
+ */
+void PuzzlePieceAtlas::replacePiece(int pieceId, const QImage& image)
+{
+    auto location = locations.find(pieceId);
+    if (location != locations.end())
+    {
+        int page = location->page;
+        if (pagePieceCounts[page] == 1)
+        {
+            pageImages[page] = image;
+            pagePixmaps[page] = QPixmap();
+            location->rect = image.rect();
+            return;
+        }
+
+        if (image.width() <= location->rect.width() && image.height() <= location->rect.height())
+        {
+            QPainter painter;
+            if (!pageImages[page].isNull())
+            {
+                painter.begin(&pageImages[page]);
+            } else
+            {
+                painter.begin(&pagePixmaps[page]);
+            }
+            painter.setCompositionMode(QPainter::CompositionMode_Source);
+            painter.fillRect(location->rect, Qt::transparent);
+            painter.drawImage(location->rect.topLeft(), image);
+            painter.end();
+
+            location->rect.setSize(image.size());
+            return;
+        }
+
+        --pagePieceCounts[page];
+    }
+
+    locations.insert(pieceId, PieceLocation{int(pageImages.count()), image.rect()});
+    pageImages.append(image);
+    pagePixmaps.append(QPixmap());
+    pagePieceCounts.append(1);
+}
+
+/**
+ * @brief Checks whether the atlas holds the piece.
+ *
+ * @param pieceId The piece id.
+ * @return True if the piece is packed in the atlas; otherwise, false.
+ */
+bool PuzzlePieceAtlas::contains(int pieceId) const
+{
+    return locations.contains(pieceId);
+}
+
+/**
+ * @brief Returns the ids of all packed pieces in ascending order.
+ *
+ * @return The sorted piece ids.
+ */
+QList<int> PuzzlePieceAtlas::pieceIds() const
+{
+    QList<int> pieceIds = locations.keys();
+    std::sort(pieceIds.begin(), pieceIds.end());
+    return pieceIds;
+}
+
+/**
+ * @brief Returns the size of a piece.
+ *
+ * @param pieceId The piece id.
+ * @return The piece size, or an invalid size for unknown pieces.
+ */
+QSize PuzzlePieceAtlas::pieceSize(int pieceId) const
+{
+    auto location = locations.constFind(pieceId);
+    return location != locations.constEnd() ? location->rect.size() : QSize();
+}
+
+/**
+ * @brief Returns the number of pages.
+ *
+ * @return The page count.
+ */
+int PuzzlePieceAtlas::pageCount() const
+{
+    return pagePixmaps.count();
+}
+
+/**
+ * @brief Returns the pixmap page, converting it from its image on first use.
+ *
+ * Must be called on the GUI thread.
+ *
+ * @param page The page index.
+ * @return The page pixmap.
+ */
+const QPixmap& PuzzlePieceAtlas::pagePixmap(int page) const
+{
+    if (pagePixmaps[page].isNull() && !pageImages[page].isNull())
+    {
+        pagePixmaps[page] = QPixmap::fromImage(pageImages[page]);
+        pageImages[page] = QImage();
+    }
+
+    return pagePixmaps[page];
+}
+
+/**
+ * @brief Returns a standalone copy of a piece, for consumers that need their own pixmap.
+ *
+ * @param pieceId The piece id.
+ * @return The piece pixmap, or a null pixmap for unknown pieces.
+ */
+QPixmap PuzzlePieceAtlas::pixmap(int pieceId) const
+{
+    auto location = locations.constFind(pieceId);
+    if (location == locations.constEnd())
+    {
+        return QPixmap();
+    }
+
+    return pagePixmap(location->page).copy(location->rect);
+}
+
+/**
+ * @brief Returns a standalone image copy of a piece, for reading its pixels.
+ *
+ * Pages that are not uploaded yet are copied from their image, uploaded pages are read back.
+ * Must be called on the GUI thread, like pagePixmap() it touches the pages, which are swapped
+ * from image to pixmap without a lock. Work off the GUI thread should use the images the atlas
+ * was built from.
+ *
+ * @param pieceId The piece id.
+ * @return The piece image, or a null image for unknown pieces.
+ */
+QImage PuzzlePieceAtlas::image(int pieceId) const
+{
+    auto location = locations.constFind(pieceId);
+    if (location == locations.constEnd())
+    {
+        return QImage();
+    }
+
+    if (!pageImages[location->page].isNull())
+    {
+        return pageImages[location->page].copy(location->rect);
+    }
+
+    return pagePixmaps[location->page].copy(location->rect).toImage();
+}
+
+/**
+ * @brief Draws a piece from its page into the target rectangle.
+ *
+ * @param painter The painter to draw with.
+ * @param target The target rectangle, the piece is scaled to fit it.
+ * @param pieceId The piece id.
+ */
+void PuzzlePieceAtlas::drawPiece(QPainter *painter, const QRect& target, int pieceId) const
+{
+    auto location = locations.constFind(pieceId);
+    if (location == locations.constEnd())
+    {
+        return;
+    }
+
+    painter->drawPixmap(target, pagePixmap(location->page), location->rect);
+}
@@ -0,0 +1,48 @@
+#ifndef PUZZLEPIECEATLAS_H
+#define PUZZLEPIECEATLAS_H
+
+#include <QHash>
+#include <QImage>
+#include <QPixmap>
+#include <QRect>
+#include <QSharedPointer>
+#include <QVector>
+
+class QPainter;
+
+class PuzzlePieceAtlas
+{
+public:
+    static constexpr int PieceIdRole = Qt::UserRole + 1;
+
+    static QSharedPointer<PuzzlePieceAtlas> build(const QHash<int, QImage>& pieces, const QSize& pageSize = QSize(4096, 4096));
+    static QSharedPointer<PuzzlePieceAtlas> fromPieces(const QHash<int, QImage>& pieces);
+
+    void replacePiece(int pieceId, const QImage& image);
+
+    bool contains(int pieceId) const;
+    QList<int> pieceIds() const;
+    QSize pieceSize(int pieceId) const;
+    int pageCount() const;
+
+    QPixmap pixmap(int pieceId) const;
+    QImage image(int pieceId) const;
+    void drawPiece(QPainter *painter, const QRect& target, int pieceId) const;
+
+private:
+    struct PieceLocation
+    {
+        int page;
+        QRect rect;
+    };
+
+    PuzzlePieceAtlas() = default;
+    const QPixmap& pagePixmap(int page) const;
+
+    QHash<int, PieceLocation> locations;
+    mutable QVector<QImage> pageImages;
+    mutable QVector<QPixmap> pagePixmaps;
+    QVector<int> pagePieceCounts;
+};
+
+#endif // PUZZLEPIECEATLAS_H
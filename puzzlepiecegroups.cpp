@@ -0,0 +1,164 @@
+#include "puzzlepiecegroups.h"
+
+/**
+ * @class PuzzlePieceGroups
+ * @brief Union-find over the pieces of a puzzle, tracking which pieces were joined together.
+ *
+ * Piece ids are the cell ids of the puzzle layout, 0 to pieceCount() - 1. Finding the group of a
+ * piece uses path halving, and joining two groups keeps the bigger one as the root and moves the
+ * member list of the smaller one over, so a piece changes lists at most log(n) times and a whole
+ * group can be walked without scanning the board. The size of the largest group is kept up to
+ * date, which makes checking for a finished puzzle a single comparison.
+ */
+
+
+/**
+ * @brief Creates groups with every piece on its own.
+ *
+ * @param pieceCount The number of pieces.
+ */
+PuzzlePieceGroups::PuzzlePieceGroups(int pieceCount)
+    : largestGroup(pieceCount > 0 ? 1 : 0)
+{
+    parents.resize(pieceCount);
+    groupMembers.resize(pieceCount);
+    for (int pieceId = 0; pieceId < pieceCount; ++pieceId)
+    {
+        parents[pieceId] = pieceId;
+        groupMembers[pieceId] = {pieceId};
+    }
+}
+
+/**
+ * @brief Returns the number of pieces.
+ *
+ * @return The piece count.
+ */
+int PuzzlePieceGroups::pieceCount() const
+{
+    return parents.count();
+}
+
+/**
+ * @brief Returns the root piece of the group a piece belongs to.
+ *
+ * @param pieceId The piece id.
+ * @return The id of the root piece.
+ */
+int PuzzlePieceGroups::find(int pieceId) const
+{
+    while (parents[pieceId] != pieceId)
+    {
+        parents[pieceId] = parents[parents[pieceId]];
+        pieceId = parents[pieceId];
+    }
+
+    return pieceId;
+}
+
+/**
+ * @brief Checks whether two pieces belong to the same group.
+ *
+ * @param firstPiece The first piece id.
+ * @param secondPiece The second piece id.
+ * @return True if the pieces are joined; otherwise, false.
+ */
+bool PuzzlePieceGroups::connected(int firstPiece, int secondPiece) const
+{
+    return find(firstPiece) == find(secondPiece);
+}
+
+/**
+ * @brief Joins the groups of two pieces.
+ *
+ * @param firstPiece The first piece id.
+ * @param secondPiece The second piece id.
+ * @return The root piece of the joined group.
+ */
+int PuzzlePieceGroups::unite(int firstPiece, int secondPiece)
+{
+    int first = find(firstPiece);
+    int second = find(secondPiece);
+    if (first == second)
+    {
+        return first;
+    }
+
+    if (groupMembers[first].count() < groupMembers[second].count())
+    {
+        std::swap(first, second);
+    }
+
+    parents[second] = first;
+    groupMembers[first].append(groupMembers[second]);
+    groupMembers[second] = QVector<int>();
+    largestGroup = qMax(largestGroup, int(groupMembers[first].count()));
+
+    return first;
+}
+
+/**
+ * @brief Returns the number of pieces in the group of a piece.
+ *
+ * @param pieceId The piece id.
+ * @return The group size.
+ */
+int PuzzlePieceGroups::groupSize(int pieceId) const
+{
+    return groupMembers[find(pieceId)].count();
+}
+
+/**
+ * @brief Returns the size of the biggest group.
+ *
+ * The puzzle is finished when it equals pieceCount().
+ *
+ * @return The largest group size.
+ */
+int PuzzlePieceGroups::largestGroupSize() const
+{
+    return largestGroup;
+}
+
+/**
+ * @brief Returns the pieces in the group of a piece.
+ *
+ * @param pieceId The piece id.
+ * @return The member piece ids, the reference is valid until the groups change.
+ */
+const QVector<int>& PuzzlePieceGroups::members(int pieceId) const
+{
+    return groupMembers[find(pieceId)];
+}
+
+/**
+ * @brief Breaks up the group of a piece, putting each of its members on its own again.
+ *
+ * Union-find cannot take a single piece out, so the caller joins the remaining members again.
+ *
+ * @param pieceId The piece id.
+ * @return The former members of the group.
+ */
+QVector<int> PuzzlePieceGroups::split(int pieceId)
+{
+    int root = find(pieceId);
+    QVector<int> formerMembers = groupMembers[root];
+    bool wasLargest = formerMembers.count() == largestGroup;
+
+    for (int member : std::as_const(formerMembers))
+    {
+        parents[member] = member;
+        groupMembers[member] = {member};
+    }
+
+    if (wasLargest && largestGroup > 1)
+    {
+        largestGroup = 1;
+        for (const QVector<int> &group : std::as_const(groupMembers))
+        {
+            largestGroup = qMax(largestGroup, int(group.count()));
+        }
+    }
+
+    return formerMembers;
+}
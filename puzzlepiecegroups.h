@@ -0,0 +1,28 @@
+#ifndef PUZZLEPIECEGROUPS_H
+#define PUZZLEPIECEGROUPS_H
+
+#include <QVector>
+#include <utility>
+
+class PuzzlePieceGroups
+{
+public:
+    PuzzlePieceGroups() = default;
+    explicit PuzzlePieceGroups(int pieceCount);
+
+    int pieceCount() const;
+    int find(int pieceId) const;
+    bool connected(int firstPiece, int secondPiece) const;
+    int unite(int firstPiece, int secondPiece);
+    int groupSize(int pieceId) const;
+    int largestGroupSize() const;
+    const QVector<int>& members(int pieceId) const;
+    QVector<int> split(int pieceId);
+
+private:
+    mutable QVector<int> parents;
+    QVector<QVector<int>> groupMembers;
+    int largestGroup = 0;
+};
+
+#endif // PUZZLEPIECEGROUPS_H
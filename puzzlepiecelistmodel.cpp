@@ -0,0 +1,257 @@
+#include "puzzlepiecelistmodel.h"
+#include <QIcon>
+
+/**
+ * @class PuzzlePieceListModel
+ * @brief A list model over piece ids, for the piece list of the main window and the piece pool.
+ *
+ * Rows hold nothing but a piece id. The text, the piece id role and the decoration are produced
+ * in data() when a view asks for them, and views only ask for the rows they paint, so no icon is
+ * created for pieces that are scrolled out of view. Rows are inserted, removed and moved with the
+ * matching begin and end calls, never by resetting the model, so persistent indexes and the view
+ * layout survive every change. Decorations come from the thumbnail level of the piece store that
+ * is closest to the icon size, and the rows are repainted once the levels are built.
+ */
+
+
+/**
+ * @brief Creates an empty model.
+ *
+ * @param parent The parent object.
+ */
+PuzzlePieceListModel::PuzzlePieceListModel(QObject *parent)
+    : QAbstractListModel(parent)
+{}
+
+/**
+ * @brief Sets the store decorations are taken from.
+ *
+ * Pieces of an atlas get no decoration, the ItemHideNameDelegate draws them from the atlas.
+ *
+ * @param store The piece store, or a null pointer.
+ */
+void PuzzlePieceListModel::setPieceStore(const QSharedPointer<PuzzlePieceStore>& store)
+{
+    if (pieceStore)
+    {
+        disconnect(pieceStore->thumbnails(), nullptr, this, nullptr);
+    }
+
+    pieceStore = store;
+    if (pieceStore)
+    {
+        connect(pieceStore->thumbnails(), &PuzzleThumbnailCache::thumbnailsReady, this, &PuzzlePieceListModel::refreshPieces);
+    }
+    refreshPieces();
+}
+
+/**
+ * @brief Sets the size decorations are drawn at, so that the matching thumbnail level is used.
+ *
+ * @param size The icon size of the view.
+ */
+void PuzzlePieceListModel::setIconSize(const QSize& size)
+{
+    iconSize = size;
+    refreshPieces();
+}
+
+/**
+ * @brief Replaces all rows.
+ *
+ * @param pieceIds The piece ids in row order.
+ */
+void PuzzlePieceListModel::setPieceIds(const QVector<int>& pieceIds)
+{
+    beginResetModel();
+    pieces = pieceIds;
+    rowsValid = false;
+    endResetModel();
+}
+
+/**
+ * @brief Returns the piece ids in row order.
+ *
+ * @return The piece ids.
+ */
+const QVector<int>& PuzzlePieceListModel::pieceIds() const
+{
+    return pieces;
+}
+
+/**
+ * @brief Returns the piece id of a row.
+ *
+ * @param row The row.
+ * @return The piece id, or -1 for rows out of range.
+ */
+int PuzzlePieceListModel::pieceId(int row) const
+{
+    return row >= 0 && row < pieces.count() ? pieces.at(row) : -1;
+}
+
+/**
+ * @brief Returns the row of a piece.
+ *
+ * The id to row table is rebuilt on the first lookup after the rows changed.
+ *
+ * @param pieceId The piece id.
+ * @return The row, or -1 if the piece has no row.
+ */
+int PuzzlePieceListModel::row(int pieceId) const
+{
+    if (!rowsValid)
+    {
+        rows.clear();
+        rows.reserve(pieces.count());
+        for (int row = 0; row < pieces.count(); ++row)
+        {
+            rows.insert(pieces.at(row), row);
+        }
+        rowsValid = true;
+    }
+
+    return rows.value(pieceId, -1);
+}
+
+/**
+ * @brief Inserts a row for a piece.
+ *
+ * @param row The row to insert at, clamped to the row count.
+ * @param pieceId The piece id.
+ */
+void PuzzlePieceListModel::insertPiece(int row, int pieceId)
+{
+    row = qBound(0, row, int(pieces.count()));
+    beginInsertRows(QModelIndex(), row, row);
+    pieces.insert(row, pieceId);
+    rowsValid = false;
+    endInsertRows();
+}
+
+/**
+ * @brief Removes a row.
+ *
+ * @param row The row to remove.
+ */
+void PuzzlePieceListModel::removePiece(int row)
+{
+    if (row < 0 || row >= pieces.count())
+    {
+        return;
+    }
+
+    beginRemoveRows(QModelIndex(), row, row);
+    pieces.removeAt(row);
+    rowsValid = false;
+    endRemoveRows();
+}
+
+/**
+ * @brief Moves a row.
+ *
+ * @param sourceRow The row to move.
+ * @param destinationRow The row the piece ends up at, clamped to the last row.
+ */
+void PuzzlePieceListModel::movePiece(int sourceRow, int destinationRow)
+{
+    if (sourceRow < 0 || sourceRow >= pieces.count())
+    {
+        return;
+    }
+
+    destinationRow = qBound(0, destinationRow, int(pieces.count()) - 1);
+    if (sourceRow == destinationRow)
+    {
+        return;
+    }
+
+    int destinationChild = destinationRow > sourceRow ? destinationRow + 1 : destinationRow;
+    beginMoveRows(QModelIndex(), sourceRow, sourceRow, QModelIndex(), destinationChild);
+    pieces.move(sourceRow, destinationRow);
+    rowsValid = false;
+    endMoveRows();
+}
+
+/**
+ * @brief Tells the views that the image of a piece changed.
+ *
+ * @param row The row of the piece.
+ */
+void PuzzlePieceListModel::refreshPiece(int row)
+{
+    if (row >= 0 && row < pieces.count())
+    {
+        emit dataChanged(index(row), index(row), {Qt::DecorationRole});
+    }
+}
+
+/**
+ * @brief Returns the number of pieces.
+ *
+ * @param parent The parent index, rows only exist below the root.
+ * @return The row count.
+ */
+int PuzzlePieceListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : pieces.count();
+}
+
+/**
+ * @brief Returns the data of a row, looking the piece up on demand.
+ *
+ * @param index The index of the row.
+ * @param role The data role.
+ * @return The piece number as text, its decoration or its piece id.
+ */
+QVariant PuzzlePieceListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= pieces.count())
+    {
+        return QVariant();
+    }
+
+    int pieceId = pieces.at(index.row());
+    switch (role)
+    {
+    case Qt::DisplayRole:
+        return QString::number(pieceId);
+    case Qt::DecorationRole:
+        if (pieceStore && !pieceStore->atlas())
+        {
+            return QIcon(pieceStore->thumbnail(pieceId, iconSize));
+        }
+        return QVariant();
+    case PuzzlePieceAtlas::PieceIdRole:
+        return pieceId;
+    default:
+        return QVariant();
+    }
+}
+
+/**
+ * @brief Returns the item flags of a row.
+ *
+ * @param index The index of the row.
+ * @return The flags, rows can be dragged and dropped on.
+ */
+Qt::ItemFlags PuzzlePieceListModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid())
+    {
+        return Qt::ItemIsDropEnabled;
+    }
+
+    return Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsDragEnabled | Qt::ItemIsDropEnabled;
+}
+
+/**
+ * @brief Tells the views that the decorations of all rows changed.
+ */
+void PuzzlePieceListModel::refreshPieces()
+{
+    if (!pieces.isEmpty())
+    {
+        emit dataChanged(index(0), index(pieces.count() - 1), {Qt::DecorationRole});
+    }
+}
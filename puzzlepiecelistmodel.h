@@ -0,0 +1,43 @@
+#ifndef PUZZLEPIECELISTMODEL_H
+#define PUZZLEPIECELISTMODEL_H
+
+#include "puzzlepiecestore.h"
+#include <QAbstractListModel>
+#include <QHash>
+#include <QVector>
+
+class PuzzlePieceListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    explicit PuzzlePieceListModel(QObject *parent = nullptr);
+
+    void setPieceStore(const QSharedPointer<PuzzlePieceStore>& store);
+    void setIconSize(const QSize& size);
+    void setPieceIds(const QVector<int>& pieceIds);
+    const QVector<int>& pieceIds() const;
+    int pieceId(int row) const;
+    int row(int pieceId) const;
+
+    void insertPiece(int row, int pieceId);
+    void removePiece(int row);
+    void movePiece(int sourceRow, int destinationRow);
+    void refreshPiece(int row);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+
+private slots:
+    void refreshPieces();
+
+private:
+    QSharedPointer<PuzzlePieceStore> pieceStore;
+    QSize iconSize;
+    QVector<int> pieces;
+    mutable QHash<int, int> rows;
+    mutable bool rowsValid = false;
+};
+
+#endif // PUZZLEPIECELISTMODEL_H
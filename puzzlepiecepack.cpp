@@ -0,0 +1,445 @@
+#include "puzzlepiecepack.h"
+#include "puzzleedgedata.h"
+#include <QSaveFile>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+
+/**
+ * @class PuzzlePiecePack
+ * @brief Stores generated puzzle pieces in a single file that is opened by memory mapping it.
+ *
+ * A piece pack holds the raw premultiplied pixels of the preview and of every piece, so
+ * opening one only parses a small index and never decodes an image. All numbers are little
+ * endian, pixels are QImage::Format_ARGB32_Premultiplied words as stored on little endian hosts.
+ *
+ * Layout of a pack file:
+ * - Header, 72 bytes at offset 0:
+ *   magic "MPCPACK\0" (8 bytes), version, header size, rows, columns, seed, image width,
+ *   image height, piece count, pixel format, preview width, preview height and preview bytes
+ *   per line as 32 bit values, the 64 bit preview offset, then the layout type as a 32 bit value
+ *   and 4 reserved zero bytes. Packs with the older 64 byte header are rectangular.
+ * - Piece index, one 64 byte entry per piece directly after the header, sorted by piece id:
+ *   piece id, row, column, x, y, width, height and bytes per line as 32 bit values (x and y
+ *   signed, the rectangle is the piece position in the source image), the 64 bit pixel offset,
+ *   the top, right, bottom and left edge ids as 32 bit values and 8 reserved zero bytes.
+ * - Pixel blobs of the preview and the pieces, each starting at an offset aligned to 64 bytes
+ *   and holding height * bytes per line bytes.
+ *
+ * Edge ids follow PuzzleEdgeData: horizontal edges row by row first, then vertical edges. Pieces
+ * of hexagonal and irregular layouts are layout cells without a grid position or a top, right,
+ * bottom and left edge, their row, column and edge ids are -1. Images returned by a pack point
+ * into the mapping and keep the pack open while they are alive, pixmaps are only created when a
+ * view converts them.
+ */
+
+
+namespace
+{
+const char packMagic[8] = {'M', 'P', 'C', 'P', 'A', 'C', 'K', '\0'};
+const quint32 packVersion = 1;
+const qint64 headerSize = 72;
+const qint64 minimumHeaderSize = 64;
+const qint64 indexEntrySize = 64;
+const qint64 blobAlignment = 64;
+
+qint64 alignedOffset(qint64 offset)
+{
+    return (offset + blobAlignment - 1) / blobAlignment * blobAlignment;
+}
+
+void putUInt32(uchar *data, qint64 offset, quint32 value)
+{
+    qToLittleEndian(value, data + offset);
+}
+
+void putUInt64(uchar *data, qint64 offset, quint64 value)
+{
+    qToLittleEndian(value, data + offset);
+}
+
+quint32 readUInt32(const uchar *data, qint64 offset)
+{
+    return qFromLittleEndian<quint32>(data + offset);
+}
+
+quint64 readUInt64(const uchar *data, qint64 offset)
+{
+    return qFromLittleEndian<quint64>(data + offset);
+}
+
+void releasePack(void *pack)
+{
+    delete static_cast<QSharedPointer<PuzzlePiecePack>*>(pack);
+}
+}
+
+PuzzlePiecePack::PuzzlePiecePack(const QString& fileName)
+    : file(fileName)
+    , mappedData(nullptr)
+    , previewOffset(0)
+    , previewBytesPerLine(0)
+{}
+
+PuzzlePiecePack::~PuzzlePiecePack()
+{
+    if (mappedData)
+    {
+        file.unmap(mappedData);
+    }
+}
+
+/**
+ * @brief Writes a piece pack file.
+ *
+ * @param fileName The file to write, replaced only once it is written completely.
+ * @param layout The grid, layout type, seed and source image size of the puzzle.
+ * @param preview The puzzle preview image.
+ * @param pieces The piece images keyed by piece id, piece id = row * columns + column for rectangular layouts.
+ * @param pieceRects The position of every piece in the source image, keyed by piece id.
+ * @param errorString Receives a description of the error if writing fails, may be null.
+ * @return True if the file was written; otherwise, false.
+ */
+bool PuzzlePiecePack::write(const QString& fileName, const Layout& layout, const QImage& preview, const QHash<int, QImage>& pieces,
+                            const QHash<int, QRect>& pieceRects, QString *errorString)
+{
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+    if (errorString)
+    {
+        *errorString = QString("piece packs can only be written on little endian hosts");
+    }
+    return false;
+#endif
+
+    if (layout.rows <= 0 || layout.columns <= 0)
+    {
+        if (errorString)
+        {
+            *errorString = QString("a piece pack needs at least one row and one column");
+        }
+        return false;
+    }
+
+    const QImage::Format pixelFormat = QImage::Format_ARGB32_Premultiplied;
+
+    QList<int> pieceIds = pieces.keys();
+    std::sort(pieceIds.begin(), pieceIds.end());
+
+    QVector<QImage> blobs;
+    blobs.append(preview.convertToFormat(pixelFormat));
+    for (int pieceId : std::as_const(pieceIds))
+    {
+        blobs.append(pieces.value(pieceId).convertToFormat(pixelFormat));
+    }
+
+    QVector<qint64> blobOffsets;
+    qint64 offset = alignedOffset(headerSize + indexEntrySize * pieceIds.count());
+    for (const QImage &blob : std::as_const(blobs))
+    {
+        blobOffsets.append(offset);
+        offset = alignedOffset(offset + blob.sizeInBytes());
+    }
+
+    QByteArray headerAndIndex(headerSize + indexEntrySize * pieceIds.count(), '\0');
+    uchar *header = reinterpret_cast<uchar*>(headerAndIndex.data());
+    std::memcpy(header, packMagic, sizeof(packMagic));
+    putUInt32(header, 8, packVersion);
+    putUInt32(header, 12, headerSize);
+    putUInt32(header, 16, layout.rows);
+    putUInt32(header, 20, layout.columns);
+    putUInt32(header, 24, layout.seed);
+    putUInt32(header, 28, layout.imageSize.width());
+    putUInt32(header, 32, layout.imageSize.height());
+    putUInt32(header, 36, pieceIds.count());
+    putUInt32(header, 40, pixelFormat);
+    putUInt32(header, 44, blobs.first().width());
+    putUInt32(header, 48, blobs.first().height());
+    putUInt32(header, 52, blobs.first().bytesPerLine());
+    putUInt64(header, 56, blobOffsets.first());
+    putUInt32(header, 64, layout.type);
+
+    for (int i = 0; i < pieceIds.count(); ++i)
+    {
+        int pieceId = pieceIds[i];
+        bool rectangular = layout.type == PuzzleGenerationSettings::RectangularLayout;
+        int row = rectangular ? pieceId / layout.columns : -1;
+        int column = rectangular ? pieceId % layout.columns : -1;
+        const QImage &blob = blobs[i + 1];
+        QRect rect(pieceRects.value(pieceId).topLeft(), blob.size());
+
+        uchar *entry = header + headerSize + indexEntrySize * i;
+        putUInt32(entry, 0, pieceId);
+        putUInt32(entry, 4, row);
+        putUInt32(entry, 8, column);
+        putUInt32(entry, 12, rect.x());
+        putUInt32(entry, 16, rect.y());
+        putUInt32(entry, 20, rect.width());
+        putUInt32(entry, 24, rect.height());
+        putUInt32(entry, 28, blob.bytesPerLine());
+        putUInt64(entry, 32, blobOffsets[i + 1]);
+        if (rectangular)
+        {
+            putUInt32(entry, 40, PuzzleEdgeData::horizontalEdgeId(row, column, layout.columns));
+            putUInt32(entry, 44, PuzzleEdgeData::verticalEdgeId(row, column + 1, layout.rows, layout.columns));
+            putUInt32(entry, 48, PuzzleEdgeData::horizontalEdgeId(row + 1, column, layout.columns));
+            putUInt32(entry, 52, PuzzleEdgeData::verticalEdgeId(row, column, layout.rows, layout.columns));
+        } else
+        {
+            for (int side = TopEdge; side <= LeftEdge; ++side)
+            {
+                putUInt32(entry, 40 + 4 * side, quint32(-1));
+            }
+        }
+    }
+
+    QSaveFile packFile(fileName);
+    if (!packFile.open(QIODevice::WriteOnly))
+    {
+        if (errorString)
+        {
+            *errorString = packFile.errorString();
+        }
+        return false;
+    }
+
+    packFile.write(headerAndIndex);
+    const QByteArray padding(blobAlignment, '\0');
+    for (int i = 0; i < blobs.count(); ++i)
+    {
+        packFile.write(padding.constData(), blobOffsets[i] - packFile.pos());
+        packFile.write(reinterpret_cast<const char*>(blobs[i].constBits()), blobs[i].sizeInBytes());
+    }
+
+    if (!packFile.commit())
+    {
+        if (errorString)
+        {
+            *errorString = packFile.errorString();
+        }
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Opens a piece pack file by memory mapping it.
+ *
+ * Only the header and the piece index are read, pixel data stays in the file until it is used.
+ *
+ * @param fileName The piece pack file.
+ * @param errorString Receives a description of the error if opening fails, may be null.
+ * @return The opened pack, or a null pointer if the file is not a valid piece pack.
+ */
+QSharedPointer<PuzzlePiecePack> PuzzlePiecePack::open(const QString& fileName, QString *errorString)
+{
+    auto fail = [errorString](const QString &message)
+    {
+        if (errorString)
+        {
+            *errorString = message;
+        }
+        return QSharedPointer<PuzzlePiecePack>();
+    };
+
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+    return fail(QString("piece packs can only be opened on little endian hosts"));
+#endif
+
+    QSharedPointer<PuzzlePiecePack> pack(new PuzzlePiecePack(fileName));
+    pack->self = pack;
+
+    if (!pack->file.open(QIODevice::ReadOnly))
+    {
+        return fail(pack->file.errorString());
+    }
+
+    qint64 fileSize = pack->file.size();
+    if (fileSize < minimumHeaderSize)
+    {
+        return fail(QString("%1 is not a piece pack").arg(fileName));
+    }
+
+    pack->mappedData = pack->file.map(0, fileSize);
+    if (!pack->mappedData)
+    {
+        return fail(pack->file.errorString());
+    }
+
+    const uchar *header = pack->mappedData;
+    if (std::memcmp(header, packMagic, sizeof(packMagic)) != 0)
+    {
+        return fail(QString("%1 is not a piece pack").arg(fileName));
+    }
+
+    if (readUInt32(header, 8) != packVersion || readUInt32(header, 40) != QImage::Format_ARGB32_Premultiplied)
+    {
+        return fail(QString("%1 uses an unsupported piece pack version").arg(fileName));
+    }
+
+    qint64 indexOffset = readUInt32(header, 12);
+    qint64 pieceCount = readUInt32(header, 36);
+    if (indexOffset < minimumHeaderSize || indexOffset + indexEntrySize * pieceCount > fileSize)
+    {
+        return fail(QString("%1 is truncated").arg(fileName));
+    }
+
+    auto blobFits = [fileSize](qint64 offset, const QSize &size, qint64 bytesPerLine)
+    {
+        if (offset < 0 || offset > fileSize || !size.isValid() || bytesPerLine < qint64(size.width()) * 4)
+        {
+            return false;
+        }
+
+        // bytes per line and height come from the file, their product could overflow
+        return size.height() == 0 || bytesPerLine <= (fileSize - offset) / size.height();
+    };
+
+    Layout &layout = pack->packLayout;
+    layout.rows = readUInt32(header, 16);
+    layout.columns = readUInt32(header, 20);
+    layout.seed = readUInt32(header, 24);
+    layout.imageSize = QSize(readUInt32(header, 28), readUInt32(header, 32));
+    if (indexOffset >= headerSize)
+    {
+        layout.type = PuzzleGenerationSettings::LayoutType(readUInt32(header, 64));
+    }
+
+    pack->previewSize = QSize(readUInt32(header, 44), readUInt32(header, 48));
+    pack->previewBytesPerLine = readUInt32(header, 52);
+    pack->previewOffset = readUInt64(header, 56);
+    if (!blobFits(pack->previewOffset, pack->previewSize, pack->previewBytesPerLine))
+    {
+        return fail(QString("%1 is truncated").arg(fileName));
+    }
+
+    pack->entries.reserve(pieceCount);
+    for (qint64 i = 0; i < pieceCount; ++i)
+    {
+        const uchar *entry = header + indexOffset + indexEntrySize * i;
+
+        PieceEntry pieceEntry;
+        pieceEntry.rect = QRect(qint32(readUInt32(entry, 12)), qint32(readUInt32(entry, 16)),
+                                readUInt32(entry, 20), readUInt32(entry, 24));
+        pieceEntry.bytesPerLine = readUInt32(entry, 28);
+        pieceEntry.offset = readUInt64(entry, 32);
+        for (int side = TopEdge; side <= LeftEdge; ++side)
+        {
+            pieceEntry.edgeIds[side] = readUInt32(entry, 40 + 4 * side);
+        }
+
+        if (!blobFits(pieceEntry.offset, pieceEntry.rect.size(), pieceEntry.bytesPerLine))
+        {
+            return fail(QString("%1 is truncated").arg(fileName));
+        }
+
+        pack->entries.insert(readUInt32(entry, 0), pieceEntry);
+    }
+
+    return pack;
+}
+
+/**
+ * @brief Returns the grid, layout type, seed and source image size stored in the pack.
+ *
+ * @return The puzzle layout.
+ */
+const PuzzlePiecePack::Layout& PuzzlePiecePack::layout() const
+{
+    return packLayout;
+}
+
+/**
+ * @brief Returns the ids of all pieces in ascending order.
+ *
+ * @return The sorted piece ids.
+ */
+QList<int> PuzzlePiecePack::pieceIds() const
+{
+    QList<int> pieceIds = entries.keys();
+    std::sort(pieceIds.begin(), pieceIds.end());
+    return pieceIds;
+}
+
+/**
+ * @brief Returns the position of a piece in the source image.
+ *
+ * @param pieceId The piece id.
+ * @return The piece rectangle, or a null rectangle for unknown pieces.
+ */
+QRect PuzzlePiecePack::pieceRect(int pieceId) const
+{
+    return entries.value(pieceId).rect;
+}
+
+/**
+ * @brief Returns the id of one of the four edges of a piece.
+ *
+ * @param pieceId The piece id.
+ * @param side The side of the piece.
+ * @return The edge id, or -1 for unknown pieces and for pieces of non-rectangular layouts.
+ */
+int PuzzlePiecePack::edgeId(int pieceId, EdgeSide side) const
+{
+    auto entry = entries.constFind(pieceId);
+    return entry != entries.constEnd() ? entry->edgeIds[side] : -1;
+}
+
+/**
+ * @brief Returns the preview image, pointing into the mapped file.
+ *
+ * @return The preview image.
+ */
+QImage PuzzlePiecePack::preview() const
+{
+    return mappedImage(previewOffset, previewSize, previewBytesPerLine);
+}
+
+/**
+ * @brief Returns a piece image, pointing into the mapped file.
+ *
+ * @param pieceId The piece id.
+ * @return The piece image, or a null image for unknown pieces.
+ */
+QImage PuzzlePiecePack::image(int pieceId) const
+{
+    auto entry = entries.constFind(pieceId);
+    if (entry == entries.constEnd())
+    {
+        return QImage();
+    }
+
+    return mappedImage(entry->offset, entry->rect.size(), entry->bytesPerLine);
+}
+
+/**
+ * @brief Returns all piece images, pointing into the mapped file.
+ *
+ * @return The piece images keyed by piece id.
+ */
+QHash<int, QImage> PuzzlePiecePack::images() const
+{
+    QHash<int, QImage> pieceImages;
+    pieceImages.reserve(entries.count());
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it)
+    {
+        pieceImages.insert(it.key(), mappedImage(it->offset, it->rect.size(), it->bytesPerLine));
+    }
+
+    return pieceImages;
+}
+
+/**
+ * @brief Wraps a pixel blob of the mapping in a read only image that keeps the pack open.
+ *
+ * @param offset The offset of the blob in the file.
+ * @param size The image size.
+ * @param bytesPerLine The bytes per line of the blob.
+ * @return The image.
+ */
+QImage PuzzlePiecePack::mappedImage(qint64 offset, const QSize& size, qsizetype bytesPerLine) const
+{
+    const uchar *data = mappedData + offset;
+    return QImage(data, size.width(), size.height(), bytesPerLine, QImage::Format_ARGB32_Premultiplied,
+                  releasePack, new QSharedPointer<PuzzlePiecePack>(self.toStrongRef()));
+}
@@ -0,0 +1,63 @@
+#ifndef PUZZLEPIECEPACK_H
+#define PUZZLEPIECEPACK_H
+
+#include "puzzlegenerationsettings.h"
+#include <QFile>
+#include <QHash>
+#include <QImage>
+#include <QRect>
+#include <QSharedPointer>
+#include <QVector>
+
+class PuzzlePiecePack
+{
+public:
+    enum EdgeSide { TopEdge, RightEdge, BottomEdge, LeftEdge };
+
+    struct Layout
+    {
+        int rows = 0;
+        int columns = 0;
+        quint32 seed = 0;
+        QSize imageSize;
+        PuzzleGenerationSettings::LayoutType type = PuzzleGenerationSettings::RectangularLayout;
+    };
+
+    ~PuzzlePiecePack();
+
+    static bool write(const QString& fileName, const Layout& layout, const QImage& preview, const QHash<int, QImage>& pieces,
+                      const QHash<int, QRect>& pieceRects, QString *errorString = nullptr);
+    static QSharedPointer<PuzzlePiecePack> open(const QString& fileName, QString *errorString = nullptr);
+
+    const Layout& layout() const;
+    QList<int> pieceIds() const;
+    QRect pieceRect(int pieceId) const;
+    int edgeId(int pieceId, EdgeSide side) const;
+
+    QImage preview() const;
+    QImage image(int pieceId) const;
+    QHash<int, QImage> images() const;
+
+private:
+    struct PieceEntry
+    {
+        QRect rect;
+        qsizetype bytesPerLine;
+        qint64 offset;
+        int edgeIds[4];
+    };
+
+    PuzzlePiecePack(const QString& fileName);
+    QImage mappedImage(qint64 offset, const QSize& size, qsizetype bytesPerLine) const;
+
+    QFile file;
+    uchar *mappedData;
+    QWeakPointer<PuzzlePiecePack> self;
+    Layout packLayout;
+    qint64 previewOffset;
+    QSize previewSize;
+    qsizetype previewBytesPerLine;
+    QHash<int, PieceEntry> entries;
+};
+
+#endif // PUZZLEPIECEPACK_H
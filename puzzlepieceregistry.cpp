@@ -0,0 +1,127 @@
+#include "puzzlepieceregistry.h"
+
+/**
+ * @class PuzzlePieceRegistry
+ * @brief Keeps track of where each piece being played with is, by piece id.
+ *
+ * The piece pool and the board share one registry. A piece is either in the pool, where the
+ * registry keeps a persistent index of its row, on the board, or nowhere while it is dragged
+ * between them. Looking up, moving and removing a piece are hash lookups, so neither dialog
+ * has to scan its rows or children or compare item texts, and the dialogs tell each other
+ * about pieces by id.
+ */
+
+
+/**
+ * @brief Returns where a piece is.
+ *
+ * @param pieceId The piece id.
+ * @return The location of the piece.
+ */
+PuzzlePieceRegistry::Location PuzzlePieceRegistry::location(int pieceId) const
+{
+    return entries.value(pieceId).location;
+}
+
+/**
+ * @brief Returns the pool row of a piece.
+ *
+ * @param pieceId The piece id.
+ * @return The index of the row, invalid if the piece is not in the pool.
+ */
+QPersistentModelIndex PuzzlePieceRegistry::trayIndex(int pieceId) const
+{
+    auto entry = entries.constFind(pieceId);
+    if (entry == entries.constEnd() || entry->location != Tray)
+    {
+        return QPersistentModelIndex();
+    }
+
+    return entry->trayIndex;
+}
+
+/**
+ * @brief Returns the number of pieces at a location.
+ *
+ * @param location The location, Tray or Board.
+ * @return The piece count.
+ */
+int PuzzlePieceRegistry::count(Location location) const
+{
+    switch (location)
+    {
+    case Tray:
+        return trayCount;
+    case Board:
+        return boardCount;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * @brief Records that a piece is in the pool.
+ *
+ * @param pieceId The piece id.
+ * @param index The index of the pool row holding the piece.
+ */
+void PuzzlePieceRegistry::placeInTray(int pieceId, const QModelIndex& index)
+{
+    Entry &entry = entries[pieceId];
+    setLocation(entry, Tray);
+    entry.trayIndex = QPersistentModelIndex(index);
+}
+
+/**
+ * @brief Records that a piece is on the board.
+ *
+ * @param pieceId The piece id.
+ */
+void PuzzlePieceRegistry::placeOnBoard(int pieceId)
+{
+    Entry &entry = entries[pieceId];
+    setLocation(entry, Board);
+    entry.trayIndex = QPersistentModelIndex();
+}
+
+/**
+ * @brief Records that a piece left its place.
+ *
+ * @param pieceId The piece id.
+ */
+void PuzzlePieceRegistry::remove(int pieceId)
+{
+    auto entry = entries.find(pieceId);
+    if (entry != entries.end())
+    {
+        setLocation(*entry, Nowhere);
+        entries.erase(entry);
+    }
+}
+
+/**
+ * @brief Moves an entry to a location, keeping the per location counts.
+ *
+ * @param entry The entry of the piece.
+ * @param location The new location.
+ */
+void PuzzlePieceRegistry::setLocation(Entry& entry, Location location)
+{
+    if (entry.location == Tray)
+    {
+        --trayCount;
+    } else if (entry.location == Board)
+    {
+        --boardCount;
+    }
+
+    entry.location = location;
+
+    if (location == Tray)
+    {
+        ++trayCount;
+    } else if (location == Board)
+    {
+        ++boardCount;
+    }
+}
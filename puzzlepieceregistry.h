@@ -0,0 +1,41 @@
+#ifndef PUZZLEPIECEREGISTRY_H
+#define PUZZLEPIECEREGISTRY_H
+
+#include <QHash>
+#include <QPersistentModelIndex>
+
+class PuzzlePieceRegistry
+{
+public:
+    enum Location
+    {
+        Nowhere,
+        Tray,
+        Board
+    };
+
+    PuzzlePieceRegistry() = default;
+
+    Location location(int pieceId) const;
+    QPersistentModelIndex trayIndex(int pieceId) const;
+    int count(Location location) const;
+
+    void placeInTray(int pieceId, const QModelIndex& index);
+    void placeOnBoard(int pieceId);
+    void remove(int pieceId);
+
+private:
+    struct Entry
+    {
+        Location location = Nowhere;
+        QPersistentModelIndex trayIndex;
+    };
+
+    void setLocation(Entry& entry, Location location);
+
+    QHash<int, Entry> entries;
+    int trayCount = 0;
+    int boardCount = 0;
+};
+
+#endif // PUZZLEPIECEREGISTRY_H
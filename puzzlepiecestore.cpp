@@ -0,0 +1,274 @@
+#include "puzzlepiecestore.h"
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QMimeData>
+#include <QPainter>
+
+/**
+ * @class PuzzlePieceStore
+ * @brief Hands out the pixmaps of the pieces being played with, by piece id.
+ *
+ * The main window, the piece pool and the board share one store, so dragging a piece only has
+ * to carry its id. Drag payloads hold the application process id, the piece id and the grab
+ * offset, a few bytes instead of the piece pixmap encoded as PNG, and the pixmap is looked up
+ * when the piece is dropped. Payloads from other processes are ignored. Pieces kept in an atlas
+ * stay in its shared pages, drawPiece() paints them from there and only pixmap() hands out a
+ * standalone copy. Drags show the thumbnail of the piece instead. The 1-bit masks used to pick pieces by their shape
+ * instead of their bounding rectangle are built on first use and kept. Views showing pieces smaller than
+ * they are draw them from the PuzzleThumbnailCache of the store.
+ */
+
+
+/**
+ * @brief Creates a store over the pieces of the current puzzle.
+ *
+ * @param pixmaps The piece pixmaps keyed by piece id, empty if the pieces are in an atlas.
+ * @param atlas The piece atlas, or a null pointer.
+ */
+PuzzlePieceStore::PuzzlePieceStore(const QHash<int, QPixmap>& pixmaps, const QSharedPointer<PuzzlePieceAtlas>& atlas)
+    : pixmaps(pixmaps)
+    , pieceAtlas(atlas)
+    , thumbnailCache(new PuzzleThumbnailCache)
+{}
+
+/**
+ * @brief Encodes the drag payload of a piece.
+ *
+ * @param pieceId The piece id.
+ * @param offset The position the piece was grabbed at, relative to its top left corner.
+ * @return The payload for QMimeData::setData.
+ */
+QByteArray PuzzlePieceStore::encodePiece(int pieceId, const QPoint& offset)
+{
+    QByteArray itemData;
+    QDataStream dataStream(&itemData, QIODevice::WriteOnly);
+    dataStream << QCoreApplication::applicationPid() << pieceId << offset;
+
+    return itemData;
+}
+
+/**
+ * @brief Decodes the drag payload of a piece.
+ *
+ * @param mimeData The dropped data.
+ * @param format The mime format holding the payload.
+ * @param pieceId Receives the piece id.
+ * @param offset Receives the grab offset, may be null.
+ * @return True if the data holds a piece of this process; otherwise, false.
+ */
+bool PuzzlePieceStore::decodePiece(const QMimeData *mimeData, const QString& format, int *pieceId, QPoint *offset)
+{
+    if (!mimeData->hasFormat(format))
+    {
+        return false;
+    }
+
+    QByteArray itemData = mimeData->data(format);
+    QDataStream dataStream(&itemData, QIODevice::ReadOnly);
+    qint64 processId = 0;
+    int id = -1;
+    QPoint grabOffset;
+    dataStream >> processId >> id >> grabOffset;
+
+    if (dataStream.status() != QDataStream::Ok || processId != QCoreApplication::applicationPid())
+    {
+        return false;
+    }
+
+    *pieceId = id;
+    if (offset)
+    {
+        *offset = grabOffset;
+    }
+    return true;
+}
+
+/**
+ * @brief Checks whether the store holds a piece.
+ *
+ * @param pieceId The piece id.
+ * @return True for known pieces; otherwise, false.
+ */
+bool PuzzlePieceStore::contains(int pieceId) const
+{
+    return pixmaps.contains(pieceId) || (pieceAtlas && pieceAtlas->contains(pieceId));
+}
+
+/**
+ * @brief Checks whether a piece is drawn from the atlas pages.
+ *
+ * @param pieceId The piece id.
+ * @return True if the piece has no pixmap of its own and is in the atlas; otherwise, false.
+ */
+bool PuzzlePieceStore::isInAtlas(int pieceId) const
+{
+    return !pixmaps.contains(pieceId) && pieceAtlas && pieceAtlas->contains(pieceId);
+}
+
+/**
+ * @brief Returns the size of a piece.
+ *
+ * @param pieceId The piece id.
+ * @return The piece size, or an invalid size for unknown pieces.
+ */
+QSize PuzzlePieceStore::pieceSize(int pieceId) const
+{
+    if (isInAtlas(pieceId))
+    {
+        return pieceAtlas->pieceSize(pieceId);
+    }
+
+    auto piece = pixmaps.constFind(pieceId);
+    return piece != pixmaps.constEnd() ? piece->deviceIndependentSize().toSize() : QSize();
+}
+
+/**
+ * @brief Returns the pixmap of a piece.
+ *
+ * Pieces of the atlas are copied out of their page on every call and the copy is not kept,
+ * so this is meant for one-off uses. Use drawPiece() to paint pieces and thumbnail() for drag pixmaps.
+ * Must be called on the GUI thread.
+ *
+ * @param pieceId The piece id.
+ * @return The piece pixmap, or a null pixmap for unknown pieces.
+ */
+QPixmap PuzzlePieceStore::pixmap(int pieceId) const
+{
+    auto piece = pixmaps.constFind(pieceId);
+    if (piece != pixmaps.constEnd())
+    {
+        return piece.value();
+    }
+
+    if (!pieceAtlas || !pieceAtlas->contains(pieceId))
+    {
+        return QPixmap();
+    }
+
+    return pieceAtlas->pixmap(pieceId);
+}
+
+/**
+ * @brief Draws a piece, from its atlas page or its own pixmap.
+ *
+ * Must be called on the GUI thread.
+ *
+ * @param painter The painter to draw with.
+ * @param target The target rectangle, the piece is scaled to fit it.
+ * @param pieceId The piece id.
+ */
+void PuzzlePieceStore::drawPiece(QPainter *painter, const QRect& target, int pieceId) const
+{
+    if (isInAtlas(pieceId))
+    {
+        pieceAtlas->drawPiece(painter, target, pieceId);
+        return;
+    }
+
+    auto piece = pixmaps.constFind(pieceId);
+    if (piece != pixmaps.constEnd())
+    {
+        painter->drawPixmap(target, piece.value());
+    }
+}
+
+/**
+ * @brief Returns the packed 1-bit mask of the opaque pixels of a piece.
+ *
+ * The mask is built from the piece alpha on first use, a pixel is set if it is at least half opaque.
+ * Atlas pieces are read from their page into a temporary image that is dropped once the mask is built.
+ * Must be called on the GUI thread.
+ *
+ * @param pieceId The piece id.
+ * @return The Format_MonoLSB mask, or a null image for unknown pieces.
+ */
+QImage PuzzlePieceStore::hitMask(int pieceId) const
+{
+    auto cached = hitMasks.constFind(pieceId);
+    if (cached != hitMasks.constEnd())
+    {
+        return cached.value();
+    }
+
+    QImage pieceImage = isInAtlas(pieceId) ? pieceAtlas->image(pieceId) : pixmaps.value(pieceId).toImage();
+    if (pieceImage.isNull())
+    {
+        return QImage();
+    }
+
+    QImage mask = pieceImage.createAlphaMask(Qt::ThresholdAlphaDither);
+    if (mask.isNull())
+    {
+        mask = QImage(pieceImage.size(), QImage::Format_MonoLSB);
+        mask.fill(1);
+    }
+
+    hitMasks.insert(pieceId, mask);
+    return mask;
+}
+
+/**
+ * @brief Returns the pixmap to draw a piece from at a size.
+ *
+ * Must be called on the GUI thread.
+ *
+ * @param pieceId The piece id.
+ * @param size The size of the area the piece is fitted into.
+ * @return The smallest thumbnail level covering the fitted piece, or the full piece pixmap.
+ */
+QPixmap PuzzlePieceStore::thumbnail(int pieceId, const QSize& size) const
+{
+    QPixmap level = thumbnailCache->thumbnail(pieceId, pieceSize(pieceId).scaled(size, Qt::KeepAspectRatio));
+    return level.isNull() ? pixmap(pieceId) : level;
+}
+
+/**
+ * @brief Replaces the pixmap of a piece that was cut again.
+ *
+ * Atlas pieces keep being drawn from the atlas, which the caller updates itself.
+ *
+ * @param pieceId The piece id.
+ * @param image The new piece image, its thumbnail levels are built from it.
+ * @param pixmap The new piece pixmap, null for atlas pieces.
+ */
+void PuzzlePieceStore::replacePiece(int pieceId, const QImage& image, const QPixmap& pixmap)
+{
+    if (!isInAtlas(pieceId))
+    {
+        pixmaps.insert(pieceId, pixmap);
+    }
+    hitMasks.remove(pieceId);
+    thumbnailCache->replacePiece(pieceId, image);
+}
+
+/**
+ * @brief Starts building the thumbnail levels of all pieces on worker threads.
+ *
+ * The images are only shared with the workers, any format conversion happens there.
+ *
+ * @param images The piece images the pixmaps or the atlas were made from, keyed by piece id.
+ */
+void PuzzlePieceStore::buildThumbnails(const QHash<int, QImage>& images)
+{
+    thumbnailCache->build(images);
+}
+
+/**
+ * @brief Returns the thumbnail cache, for views that repaint once it is ready.
+ *
+ * @return The thumbnail cache.
+ */
+PuzzleThumbnailCache* PuzzlePieceStore::thumbnails() const
+{
+    return thumbnailCache.data();
+}
+
+/**
+ * @brief Returns the atlas the pieces are drawn from.
+ *
+ * @return The piece atlas, or a null pointer if every piece has its own pixmap.
+ */
+const QSharedPointer<PuzzlePieceAtlas>& PuzzlePieceStore::atlas() const
+{
+    return pieceAtlas;
+}
@@ -0,0 +1,42 @@
+#ifndef PUZZLEPIECESTORE_H
+#define PUZZLEPIECESTORE_H
+
+#include "puzzlepieceatlas.h"
+#include "puzzlethumbnailcache.h"
+#include <QByteArray>
+#include <QHash>
+#include <QImage>
+#include <QPixmap>
+#include <QPoint>
+
+class QMimeData;
+class QPainter;
+
+class PuzzlePieceStore
+{
+public:
+    PuzzlePieceStore(const QHash<int, QPixmap>& pixmaps, const QSharedPointer<PuzzlePieceAtlas>& atlas);
+
+    static QByteArray encodePiece(int pieceId, const QPoint& offset = QPoint());
+    static bool decodePiece(const QMimeData *mimeData, const QString& format, int *pieceId, QPoint *offset = nullptr);
+
+    bool contains(int pieceId) const;
+    bool isInAtlas(int pieceId) const;
+    QSize pieceSize(int pieceId) const;
+    QPixmap pixmap(int pieceId) const;
+    void drawPiece(QPainter *painter, const QRect& target, int pieceId) const;
+    QImage hitMask(int pieceId) const;
+    QPixmap thumbnail(int pieceId, const QSize& size) const;
+    void replacePiece(int pieceId, const QImage& image, const QPixmap& pixmap);
+    void buildThumbnails(const QHash<int, QImage>& images);
+    const QSharedPointer<PuzzlePieceAtlas>& atlas() const;
+    PuzzleThumbnailCache* thumbnails() const;
+
+private:
+    QHash<int, QPixmap> pixmaps;
+    mutable QHash<int, QImage> hitMasks;
+    QSharedPointer<PuzzlePieceAtlas> pieceAtlas;
+    QSharedPointer<PuzzleThumbnailCache> thumbnailCache;
+};
+
+#endif // PUZZLEPIECESTORE_H
@@ -0,0 +1,115 @@
+#include "puzzlepreviewlabel.h"
+#include <QMouseEvent>
+#include <QPaintEvent>
+#include <QPainter>
+
+/**
+ * @class PuzzlePreviewLabel
+ * @brief Shows the image with the puzzle cutting lines as an overlay.
+ *
+ * The lines are not part of the pixmap. They are drawn over it at the current label size,
+ * limited to the area being repainted, so zooming keeps them sharp and hiding them needs no
+ * second image. With edge picking enabled, clicking a cutting line reports the edge under
+ * the cursor.
+ */
+
+
+PuzzlePreviewLabel::PuzzlePreviewLabel(QWidget *parent)
+    : QLabel(parent)
+    , edgesVisible(true)
+    , edgePickingEnabled(false)
+{}
+
+/**
+ * @brief Sets the cutting lines shown over the image.
+ *
+ * @param edges The puzzle edges in source image coordinates.
+ * @param sourceSize The size of the source image, the label may show it scaled.
+ */
+void PuzzlePreviewLabel::setEdges(const QVector<PuzzleEdge>& edges, const QSize& sourceSize)
+{
+    edgeOverlay.setEdges(edges, sourceSize);
+    update();
+}
+
+/**
+ * @brief Replaces one cutting line and repaints only the area it covers.
+ *
+ * @param edgeId The id of the edge.
+ * @param edge The new edge in source image coordinates.
+ */
+void PuzzlePreviewLabel::updateEdge(int edgeId, const PuzzleEdge& edge)
+{
+    QRect dirtyRect = edgeOverlay.edgeRect(edgeId, size());
+    edgeOverlay.setEdge(edgeId, edge);
+    update(dirtyRect.united(edgeOverlay.edgeRect(edgeId, size())));
+}
+
+/**
+ * @brief Removes the cutting lines.
+ */
+void PuzzlePreviewLabel::clearEdges()
+{
+    edgeOverlay.clear();
+    update();
+}
+
+/**
+ * @brief Shows or hides the cutting lines.
+ *
+ * @param visible True to draw the cutting lines.
+ */
+void PuzzlePreviewLabel::setEdgesVisible(bool visible)
+{
+    edgesVisible = visible;
+    update();
+}
+
+/**
+ * @brief Enables reporting clicked cutting lines with edgeClicked.
+ *
+ * @param enabled True to report clicks on cutting lines.
+ */
+void PuzzlePreviewLabel::setEdgePickingEnabled(bool enabled)
+{
+    edgePickingEnabled = enabled;
+    setCursor(enabled ? Qt::PointingHandCursor : Qt::ArrowCursor);
+}
+
+/**
+ * @brief Paints the image and, if enabled, the cutting lines over the repainted area.
+ *
+ * @param event The paint event.
+ */
+void PuzzlePreviewLabel::paintEvent(QPaintEvent *event)
+{
+    QLabel::paintEvent(event);
+
+    if (!edgesVisible || edgeOverlay.isEmpty())
+    {
+        return;
+    }
+
+    QPainter painter(this);
+    edgeOverlay.paint(&painter, size(), event->rect());
+}
+
+/**
+ * @brief Emits edgeClicked for the cutting line under the cursor, if edge picking is enabled.
+ *
+ * @param event The mouse event.
+ */
+void PuzzlePreviewLabel::mousePressEvent(QMouseEvent *event)
+{
+    if (!edgePickingEnabled || !edgesVisible || event->button() != Qt::LeftButton)
+    {
+        QLabel::mousePressEvent(event);
+        return;
+    }
+
+    int edgeId = edgeOverlay.edgeAt(event->position().toPoint(), size(), 4);
+    if (edgeId >= 0)
+    {
+        emit edgeClicked(edgeId);
+    }
+}
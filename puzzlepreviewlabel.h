@@ -0,0 +1,35 @@
+#ifndef PUZZLEPREVIEWLABEL_H
+#define PUZZLEPREVIEWLABEL_H
+
+#include "puzzleedgeoverlay.h"
+#include <QLabel>
+
+class PuzzlePreviewLabel : public QLabel
+{
+    Q_OBJECT
+
+public:
+    explicit PuzzlePreviewLabel(QWidget *parent = nullptr);
+
+    void setEdges(const QVector<PuzzleEdge>& edges, const QSize& sourceSize);
+    void updateEdge(int edgeId, const PuzzleEdge& edge);
+    void clearEdges();
+
+public slots:
+    void setEdgesVisible(bool visible);
+    void setEdgePickingEnabled(bool enabled);
+
+signals:
+    void edgeClicked(int edgeId);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+
+private:
+    PuzzleEdgeOverlay edgeOverlay;
+    bool edgesVisible;
+    bool edgePickingEnabled;
+};
+
+#endif // PUZZLEPREVIEWLABEL_H
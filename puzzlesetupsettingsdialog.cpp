@@ -3,6 +3,9 @@
 #include <QIntValidator>
 #include <QVector>
 #include <QButtonGroup>
+#include <QThread>
+#include <QRandomGenerator>
+#include <limits>
 
 /**
  * @class PuzzleSetUpSettingsDialog
@@ -26,6 +29,19 @@ PuzzleSetUpSettingsDialog::PuzzleSetUpSettingsDialog(const QVector<int> &imageSi
 
     setUpComboBoxes(maxRows, maxColumns);
 
+    ui->spinBox_threads->setRange(0, QThread::idealThreadCount());
+    ui->spinBox_threads->setValue(0);
+
+    ui->comboBox_layout->addItem(tr("Rectangular"), PuzzleGenerationSettings::RectangularLayout);
+    ui->comboBox_layout->addItem(tr("Hexagonal"), PuzzleGenerationSettings::HexagonalLayout);
+    ui->comboBox_layout->addItem(tr("Irregular"), PuzzleGenerationSettings::IrregularLayout);
+
+    ui->comboBox_engine->addItem(tr("Per piece"), PuzzleGenerationSettings::PerShape);
+    ui->comboBox_engine->addItem(tr("Single pass (large puzzles)"), PuzzleGenerationSettings::LabelMap);
+
+    ui->spinBox_seed->setRange(0, std::numeric_limits<int>::max());
+    ui->spinBox_seed->setValue(QRandomGenerator::global()->bounded(std::numeric_limits<int>::max()));
+
     calculateShapeSize();
 
     connect(ui->comboBox_row, QOverload<int>::of(&QComboBox::currentIndexChanged),
@@ -117,7 +133,17 @@ void PuzzleSetUpSettingsDialog::on_pushButton_Accept_clicked()
     int shapeNumberRow = ui->comboBox_row->currentText().toInt();
     int shapeNumberColumn = ui->comboBox_column->currentText().toInt();
 
-    emit acceptPuzzleDimensions(shapeNumberRow, shapeNumberColumn);
+    PuzzleGenerationSettings settings;
+    settings.threadCount = ui->spinBox_threads->value();
+    settings.layoutType = static_cast<PuzzleGenerationSettings::LayoutType>(ui->comboBox_layout->currentData().toInt());
+    settings.cuttingEngine = static_cast<PuzzleGenerationSettings::CuttingEngine>(ui->comboBox_engine->currentData().toInt());
+    settings.seed = quint32(ui->spinBox_seed->value());
+    settings.useMaskCache = ui->checkBox_maskCache->isChecked();
+    settings.useAtlas = ui->checkBox_atlas->isChecked();
+    settings.maskRasterizer = ui->checkBox_antialiasing->isChecked() ? PuzzleGenerationSettings::ScanlineMask
+                                                                      : PuzzleGenerationSettings::PainterMask;
+
+    emit acceptPuzzleDimensions(shapeNumberRow, shapeNumberColumn, settings);
 
     close();
 }
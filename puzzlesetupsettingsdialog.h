@@ -1,6 +1,7 @@
 #ifndef PUZZLESETUPSETTINGSDIALOG_H
 #define PUZZLESETUPSETTINGSDIALOG_H
 
+#include "puzzlegenerationsettings.h"
 #include <QDialog>
 #include <QSize>
 
@@ -37,7 +38,7 @@ private:
     int maxColumns;
 
 signals:
-    void acceptPuzzleDimensions(int rows, int columns);
+    void acceptPuzzleDimensions(int rows, int columns, const PuzzleGenerationSettings& settings);
 };
 
 #endif // PUZZLESETUPSETTINGSDIALOG_H
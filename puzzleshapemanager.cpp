@@ -1,6 +1,18 @@
-#include "mainwindow.h"
 #include "puzzleshapemanager.h"
 #include "imagedividerwithbezier.h"
+#include "puzzlelabelmapcutter.h"
+#include "maskapplykernel.h"
+#include "puzzlepieceatlas.h"
+#include "puzzlepiecepack.h"
+#include "puzzleedgeoverlay.h"
+#include "puzzleoutlinerasterizer.h"
+#include <QImageReader>
+#include <QFutureWatcher>
+#include <QLineF>
+#include <QPainter>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
 
 /**
  * @class PuzzleShapeManager
@@ -12,126 +24,469 @@
  */
 
 
-PuzzleShapeManager::PuzzleShapeManager(int rows, int columns, const QImage& image, QObject *parent)
-    : myImage(image)
-    , myImageCopy(image)
+PuzzleShapeManager::PuzzleShapeManager(int rows, int columns, const QImage& image, const PuzzleGenerationSettings& settings, QObject *parent)
+    : QObject(parent)
+    , premultipliedImage(MaskApplyKernel::premultipliedSource(image))
+    , imageSize(image.size())
+    , settings(settings)
+    , hasCachedLayout(false)
     , rows(rows)
     , columns(columns)
 {
-    this->parent = parent;
     userShapes = columns*rows;
-    puzzleEdgeData = new PuzzleEdgeData();
-    points = generatePoints();
-    bezierShapes();
+    pieceLayout = PuzzleLayout::create(settings.layoutType, imageSize, rows, columns, settings.seed);
+    puzzleEdgeData = new PuzzleEdgeData(pieceLayout.edgeCount(), this);
 }
 
+/**
+ * @brief Creates a manager that streams the source image from a file in tiles.
+ *
+ * The image is never decoded as a whole. The preview is rendered on a scaled down copy and the
+ * pieces are cut tile by tile, so peak memory depends on the tile size instead of the image size.
+ * The tiled mode always cuts per piece and does not use the mask cache. Orientation metadata is
+ * ignored, because clip rectangles apply to the stored image. The file format has to pass
+ * supportsTiledGeneration(), otherwise every tile would decode the whole image.
+ *
+ * @param rows Number of rows in the puzzle.
+ * @param columns Number of columns in the puzzle.
+ * @param imageFileName The image file to read tiles from.
+ * @param settings Options used while generating and cutting the shapes.
+ * @param parent The parent object.
+ */
+PuzzleShapeManager::PuzzleShapeManager(int rows, int columns, const QString& imageFileName, const PuzzleGenerationSettings& settings, QObject *parent)
+    : QObject(parent)
+    , imageFileName(imageFileName)
+    , imageSize(QImageReader(imageFileName).size())
+    , settings(settings)
+    , hasCachedLayout(false)
+    , rows(rows)
+    , columns(columns)
+{
+    this->settings.useMaskCache = false;
+    this->settings.cuttingEngine = PuzzleGenerationSettings::PerShape;
+
+    userShapes = columns*rows;
+    pieceLayout = PuzzleLayout::create(settings.layoutType, imageSize, rows, columns, settings.seed);
+    puzzleEdgeData = new PuzzleEdgeData(pieceLayout.edgeCount(), this);
+}
+
+/**
+ * @brief Checks whether an image is too large to be decoded as a whole.
+ *
+ * @param imageSize The size of the image.
+ * @return True if the image should be generated in tiles from its file; otherwise, false.
+ */
+bool PuzzleShapeManager::requiresTiledGeneration(const QSize& imageSize)
+{
+    const qint64 largestPixelCount = qint64(20000) * 20000;
+    qint64 pixelCount = qint64(imageSize.width()) * imageSize.height();
+    qint64 allocationLimit = qint64(QImageReader::allocationLimit()) * 1024 * 1024;
+
+    return pixelCount > largestPixelCount || (allocationLimit > 0 && pixelCount * 4 > allocationLimit);
+}
+
+/**
+ * @brief Checks whether an image file can be read in tiles and scaled down while decoding.
+ *
+ * Formats whose decoders cannot clip or scale, such as PNG and TIFF, would decode the whole
+ * image for every tile and fail on the same allocation limit tiling is meant to avoid.
+ *
+ * @param imageFileName The image file.
+ * @return True if its decoder supports clip rectangles and scaled sizes; otherwise, false.
+ */
+bool PuzzleShapeManager::supportsTiledGeneration(const QString& imageFileName)
+{
+    QImageReader reader(imageFileName);
+    return reader.supportsOption(QImageIOHandler::ClipRect) && reader.supportsOption(QImageIOHandler::ScaledSize);
+}
+
+/**
+ * @brief Checks whether the source image is streamed from a file in tiles.
+ *
+ * @return True in tiled mode; otherwise, false.
+ */
+bool PuzzleShapeManager::isTiled() const
+{
+    return !imageFileName.isEmpty();
+}
+
+/**
+ * @brief Destroys the manager, waiting for a running cut.
+ *
+ * Owners on the GUI thread should use deleteWhenIdle() instead, which does not block.
+ */
 PuzzleShapeManager::~PuzzleShapeManager()
 {
+    cuttingCanceled.storeRelaxed(1);
+    cuttingFuture.waitForFinished();
+}
+
+/**
+ * @brief Asks a running background cut to stop.
+ *
+ * The cutting loops check the request between pieces and tiles, a canceled cut emits nothing.
+ */
+void PuzzleShapeManager::cancelCutting()
+{
+    cuttingCanceled.storeRelaxed(1);
+}
+
+/**
+ * @brief Checks whether the running cut was asked to stop.
+ *
+ * @return True after cancelCutting(); otherwise, false.
+ */
+bool PuzzleShapeManager::isCuttingCanceled() const
+{
+    return cuttingCanceled.loadRelaxed() != 0;
+}
 
+/**
+ * @brief Cancels a running cut and deletes the manager once the worker has stopped.
+ *
+ * All signal connections are dropped at once, so a replaced manager delivers nothing more to
+ * its former receivers. Suits QSharedPointer as deleter, the GUI thread is never blocked.
+ */
+void PuzzleShapeManager::deleteWhenIdle()
+{
+    cancelCutting();
+    disconnect();
+
+    if (cuttingFuture.isFinished())
+    {
+        deleteLater();
+        return;
+    }
+
+    QFutureWatcher<void> *watcher = new QFutureWatcher<void>(this);
+    connect(watcher, &QFutureWatcher<void>::finished, this, &QObject::deleteLater);
+    watcher->setFuture(cuttingFuture);
 }
 
 /**
- * @brief Saves an edge along with its associated QPainterPath.
+ * @brief Generates the puzzle edges and all puzzle shapes.
+ *
+ * Results are announced with puzzleEdgesReady and then puzzleShapesReady or puzzleAtlasReady,
+ * and stay available from puzzleEdges and shapeImages afterwards. No widgets or pixmaps are
+ * created, so generation also works without a GUI platform. If a tile of the image file cannot
+ * be read, puzzleCuttingFailed is emitted instead and no pieces are kept.
  *
- * @param edge The edge represented by a pair of QPoint.
- * @param path The QPainterPath associated with the edge.
+ * @return True if every piece was cut; otherwise, false and errorString() tells why.
  */
-void PuzzleShapeManager::saveEdge(const QPair<QPoint, QPoint>& edge, const QPainterPath& path)
+bool PuzzleShapeManager::generate()
 {
-    puzzleEdgeData->addEdge(edge, path);
+    generateEdges();
+    return cutPuzzleShapes();
 }
 
 /**
- * @brief Loads the QPainterPath associated with the given edge.
+ * @brief Generates the puzzle edges right away and cuts the shapes on a worker thread.
  *
- * @param edge The edge represented by a pair of QPoint.
- * @return The QPainterPath associated with the edge.
+ * puzzleEdgesReady is emitted before this returns, so the cutting lines can be shown at once.
+ * puzzleShapesReady, puzzleAtlasReady or puzzleCuttingFailed follow from the worker thread when cutting finishes,
+ * receivers living on other threads get them queued. The cut can be stopped with cancelCutting(),
+ * and deleteWhenIdle() disposes of the manager without waiting for it.
  */
-const QPainterPath PuzzleShapeManager::loadEdge(const QPair<QPoint, QPoint>& edge) const
+void PuzzleShapeManager::generateInBackground()
 {
-    return puzzleEdgeData->getEdgeByPoints(edge.first, edge.second);
+    cancelCutting();
+    cuttingFuture.waitForFinished();
+    cuttingCanceled.storeRelaxed(0);
+    generateEdges();
+    cuttingFuture = QtConcurrent::run([this]()
+    {
+        cutPuzzleShapes();
+    });
 }
 
 /**
- * @brief Generates the points for the puzzle grid.
+ * @brief Regenerates one edge with a new shape and re-cuts only the two pieces sharing it.
+ *
+ * The edge draws from the next reroll stream of its PuzzleEdgeRandom, so the cost does not
+ * depend on the number of pieces. Border edges are straight and are never regenerated. The
+ * layout no longer matches the seed afterwards, so its mask cache entry is dropped and this
+ * manager stops using the mask cache. Nothing is done while a background cut is still running.
+ * Emits puzzleEdgeChanged and puzzlePiecesChanged. If a piece cannot be read from the image
+ * file, the old edge is kept and errorString() tells why.
  *
- * @return A QVector containing the generated points.
+ * @param edgeId The id of the edge to regenerate.
+ * @return True if the edge was regenerated; false while cutting, for unknown ids, border edges, before the edges are generated or on read errors.
  */
-QVector<QPoint> PuzzleShapeManager::generatePoints()
+bool PuzzleShapeManager::regenerateEdge(int edgeId)
 {
-    int imageWidth = myImage.width();
-    int imageHeight = myImage.height();
+    cuttingError.clear();
+
+    if (cuttingFuture.isRunning() || edgeId < 0 || edgeId >= puzzleEdgeData->count())
+    {
+        return false;
+    }
+
+    const PuzzleEdge oldEdge = puzzleEdgeData->getEdge(edgeId);
+    if (oldEdge.isNull() || (oldEdge.flags & PuzzleEdge::Straight))
+    {
+        return false;
+    }
 
-    horizontalSpacing = imageWidth / columns;
-    verticalSpacing = imageHeight / rows;
+    if (settings.useMaskCache)
+    {
+        PuzzleMaskCache::instance().removeLayout(maskLayoutKey);
+        settings.useMaskCache = false;
+        hasCachedLayout = false;
+        maskLayout = PuzzleMaskLayout();
+    }
 
-    int leftoverXSpacing = imageWidth - horizontalSpacing;
-    int leftoverYSpacing = imageHeight - verticalSpacing;
+    ++edgeRerolls[edgeId];
+    ImageDividerWithBezier classicPuzzles(this);
+    PuzzleEdge edge = createEdge(classicPuzzles, edgeId);
+    puzzleEdgeData->setEdge(edgeId, edge);
 
-    for (int row = 0; row <= rows; ++row)
+    QHash<int, QImage> changedPieces;
+    QHash<int, QRect> changedRegions;
+    for (int pieceId : pieceLayout.edge(edgeId).cells)
     {
-        for (int col = 0; col <= columns; ++col)
+        QPainterPath shape = pieceShape(pieceId);
+        QImage pieceImage = cutImage(shape, &cuttingError);
+        if (pieceImage.isNull())
         {
-            int x = col * horizontalSpacing;
-            int y = row * verticalSpacing;
+            puzzleEdgeData->setEdge(edgeId, oldEdge);
+            --edgeRerolls[edgeId];
+            return false;
+        }
 
-            if(col != 0 && leftoverXSpacing != 0)
-            {
-                x += 1;
-                leftoverXSpacing--;
-            }
+        changedPieces.insert(pieceId, pieceImage);
+        changedRegions.insert(pieceId, calculateCuttingRegion(shape));
+    }
+    pieceImages.insert(changedPieces);
+    pieceRegions.insert(changedRegions);
 
+    emit puzzleEdgeChanged(edgeId, edge);
+    emit puzzlePiecesChanged(changedPieces);
+    return true;
+}
 
-            if(row != 0 && leftoverYSpacing != 0)
-            {
-                y += 1;
-                leftoverYSpacing--;
-            }
+/**
+ * @brief Generates the puzzle edges, or takes them from the cached mask layout, and announces them.
+ */
+void PuzzleShapeManager::generateEdges()
+{
+    if (settings.useMaskCache)
+    {
+        maskLayoutKey = PuzzleMaskLayoutKey{imageSize, rows, columns, settings.seed, settings.flatteningTolerance, settings.maskRasterizer,
+                                            settings.layoutType};
+        hasCachedLayout = PuzzleMaskCache::instance().findLayout(maskLayoutKey, maskLayout);
+    }
 
-            if(row == rows)
-            {
-                y = imageHeight;
-            }
+    if (hasCachedLayout)
+    {
+        puzzleEdgeData->setEdges(maskLayout.edges);
+    } else
+    {
+        bezierShapes();
+    }
 
-            if (col == columns)
-            {
-                x = imageWidth;
-            }
-            points.append(QPoint(x, y));
-        }
+    emit puzzleEdgesReady(puzzleEdgeData->getAllEdges());
+}
+
+/**
+ * @brief Renders the preview image with the cutting lines drawn on it.
+ *
+ * Views should draw puzzleEdges as an overlay instead; this is meant for saving the preview.
+ *
+ * @return The preview image, at most 4096 pixels wide or high in tiled mode, or a null image if
+ *         the image file cannot be read.
+ */
+QImage PuzzleShapeManager::puzzlePreview() const
+{
+    QImage previewBase = createPreviewBase();
+    if (previewBase.isNull())
+    {
+        return QImage();
     }
 
-    points.last() = QPoint(imageWidth, imageHeight);
+    return PuzzleEdgeOverlay::render(previewBase, puzzleEdgeData->getAllEdges(), imageSize);
+}
 
-    return points;
+/**
+ * @brief Returns the generated edges in source image coordinates, indexed by edge id.
+ *
+ * @return The puzzle edges, default constructed before generate has run.
+ */
+const QVector<PuzzleEdge>& PuzzleShapeManager::puzzleEdges() const
+{
+    return puzzleEdgeData->getAllEdges();
 }
 
 /**
- * @brief Generates Bezier shapes for the puzzle edges.
+ * @brief Returns the cut puzzle shapes.
  *
- * Uses the generated points to create Bezier shapes for the puzzle edges.
+ * @return The premultiplied shape images keyed by piece id, empty before generate has run.
  */
-void PuzzleShapeManager::bezierShapes()
+const QHash<int, QImage>& PuzzleShapeManager::shapeImages() const
+{
+    return pieceImages;
+}
+
+/**
+ * @brief Returns why the last cut failed.
+ *
+ * @return The error of the last generate or regenerateEdge call, empty if it succeeded.
+ */
+QString PuzzleShapeManager::errorString() const
 {
-    ImageDividerWithBezier classicPuzzles(myImage, this);
-    connect(&classicPuzzles, &ImageDividerWithBezier::saveEdge,this, &PuzzleShapeManager::saveEdge);
-    connect(&classicPuzzles, &ImageDividerWithBezier::loadPreviewImage, this, &PuzzleShapeManager::receivePreviewImage);
+    return cuttingError;
+}
 
-    for (int i = 0; i < points.length(); ++i)
+/**
+ * @brief Returns where every cut piece lies in the source image.
+ *
+ * @return The cutting regions keyed by piece id.
+ */
+const QHash<int, QRect>& PuzzleShapeManager::shapeRegions() const
+{
+    return pieceRegions;
+}
+
+/**
+ * @brief Returns how the image is divided into pieces.
+ *
+ * @return The layout, its cell ids are the piece ids.
+ */
+const PuzzleLayout& PuzzleShapeManager::puzzleLayout() const
+{
+    return pieceLayout;
+}
+
+/**
+ * @brief Returns the outline a piece is cut along.
+ *
+ * @param pieceId The piece id.
+ * @return The closed outline in source image coordinates, empty for unknown ids or before generate has run.
+ */
+QPainterPath PuzzleShapeManager::pieceOutline(int pieceId) const
+{
+    if (pieceId < 0 || pieceId >= pieceLayout.cellCount())
     {
-        if((i+1) < points.length() && points[i].y() == points[i+1].y())
-        {
-            classicPuzzles.setBezierPoints(points[i], generateBezierFlowPoints(points[i],points[i+1]), points[i+1]);
-            classicPuzzles.prepareToCutImage();
-        }
+        return QPainterPath();
+    }
+
+    return pieceShape(pieceId);
+}
 
-        if ((i + (columns+1)) < points.length())
+/**
+ * @brief Writes the preview and the cut pieces to a PuzzlePiecePack file.
+ *
+ * @param fileName The piece pack file to write.
+ * @param errorString Receives a description of the error if writing fails, may be null.
+ * @return True if the file was written; otherwise, false.
+ */
+bool PuzzleShapeManager::writePiecePack(const QString& fileName, QString *errorString) const
+{
+    PuzzlePiecePack::Layout layout;
+    layout.rows = rows;
+    layout.columns = columns;
+    layout.seed = settings.seed;
+    layout.imageSize = imageSize;
+    layout.type = pieceLayout.type();
+
+    QImage preview = puzzlePreview();
+    if (preview.isNull())
+    {
+        if (errorString)
         {
-            classicPuzzles.setBezierPoints(points[i], generateBezierFlowPoints(points[i],points[i+(columns+1)]), points[i+(columns+1)]);
-            classicPuzzles.prepareToCutImage();
+            *errorString = QString("cannot read the preview of %1").arg(imageFileName);
         }
+        return false;
     }
-    classicPuzzles.imageCopyPreview();
+
+    return PuzzlePiecePack::write(fileName, layout, preview, pieceImages, pieceRegions, errorString);
+}
+
+/**
+ * @brief Generates Bezier shapes for the puzzle edges.
+ *
+ * Creates a Bezier shape for every edge of the layout. Every edge draws its random numbers from
+ * its own PuzzleEdgeRandom stream, keyed by the seed, the edge id and its reroll count, and all
+ * edges are handed to the edge store in one batch.
+ */
+void PuzzleShapeManager::bezierShapes()
+{
+    ImageDividerWithBezier classicPuzzles(this);
+
+    QVector<PuzzleEdge> edges(puzzleEdgeData->count());
+
+    for (int edgeId = 0; edgeId < edges.count(); ++edgeId)
+    {
+        edges[edgeId] = createEdge(classicPuzzles, edgeId);
+    }
+    puzzleEdgeData->setEdges(edges);
+}
+
+/**
+ * @brief Returns the image the preview is rendered on.
+ *
+ * In tiled mode this is a copy of the source scaled down while decoding, otherwise the premultiplied
+ * source the pieces are cut from, the only copy of the image the manager keeps.
+ *
+ * @return The preview base image, a null image if the image file cannot be read.
+ */
+QImage PuzzleShapeManager::createPreviewBase() const
+{
+    if (!isTiled())
+    {
+        return premultipliedImage;
+    }
+
+    const int previewExtent = 4096;
+    QImageReader reader(imageFileName);
+    reader.setScaledSize(imageSize.scaled(previewExtent, previewExtent, Qt::KeepAspectRatio).boundedTo(imageSize));
+
+    return reader.read();
+}
+
+/**
+ * @brief Generates the shape of one edge.
+ *
+ * Edges on the image border, and edges too short to carry a tab, are straight. Edges of the
+ * rectangular grid are horizontal or vertical and are generated in place. Other edges are
+ * generated along the x axis, with a tab as large as on a square piece of their length, and
+ * framed between their end points.
+ *
+ * @param divider The divider that turns the Bezier points into an edge.
+ * @param edgeId The id of the edge.
+ * @return The edge, drawn from the random stream of its current reroll.
+ */
+PuzzleEdge PuzzleShapeManager::createEdge(ImageDividerWithBezier& divider, int edgeId)
+{
+    const PuzzleLayout::Edge &layoutEdge = pieceLayout.edge(edgeId);
+    QPoint p1 = layoutEdge.start;
+    QPoint p7 = layoutEdge.end;
+
+    QSize cellSpacing = pieceLayout.cellSpacing();
+    int length = qRound(QLineF(p1, p7).length());
+    if (pieceLayout.isBorderEdge(edgeId) || length < qMin(cellSpacing.width(), cellSpacing.height()) / 4)
+    {
+        PuzzleEdge edge;
+        edge.flags = PuzzleEdge::Generated | PuzzleEdge::Straight;
+        edge.controlPoints[0] = p1;
+        edge.controlPoints[6] = p7;
+        return edge;
+    }
+
+    PuzzleEdgeRandom random(settings.seed, edgeId, edgeRerolls.value(edgeId));
+    if (pieceLayout.type() == PuzzleGenerationSettings::RectangularLayout)
+    {
+        QVector<QPoint> bezierPoints = generateBezierFlowPoints(p1, p7, cellSpacing, random);
+        divider.setBezierPoints(p1, bezierPoints, p7, random);
+        return divider.prepareToCutImage();
+    }
+
+    QPoint frameEnd(length, 0);
+    QVector<QPoint> bezierPoints = generateBezierFlowPoints(QPoint(0, 0), frameEnd, QSize(length, length), random);
+    divider.setBezierPoints(QPoint(0, 0), bezierPoints, frameEnd, random);
+
+    PuzzleEdge edge = divider.prepareToCutImage();
+    edge.setFrame(p1, p7);
+    return edge;
 }
 
 /**
@@ -141,22 +496,27 @@ void PuzzleShapeManager::bezierShapes()
  *
  * @param p1 The start point.
  * @param p7 The end point.
+ * @param spacing The size of a piece, the tab is scaled to it.
+ * @param random The random stream of the edge.
  * @return A QVector containing the generated Bezier flow points.
  */
-QVector<QPoint> PuzzleShapeManager::generateBezierFlowPoints(QPoint p1, QPoint p7)
+QVector<QPoint> PuzzleShapeManager::generateBezierFlowPoints(QPoint p1, QPoint p7, const QSize& spacing, PuzzleEdgeRandom &random)
 {
+    int horizontalSpacing = spacing.width();
+    int verticalSpacing = spacing.height();
+
     QVector<QPoint> bezierPoints;
     bool isVertical = (p1.x() == p7.x());
-    int multiplier = (rand() % 2 == 0) ? 1 : -1;
+    int multiplier = (random.bounded(2) == 0) ? 1 : -1;
 
     QPoint p2;
     if (isVertical)
     {
         p2.setX(p1.x());
-        p2.setY(p1.y() + verticalSpacing * (0.4 + (rand() % 21) / 100.0));
+        p2.setY(p1.y() + verticalSpacing * (0.4 + random.bounded(21) / 100.0));
     } else
     {
-        p2.setX(p1.x() + horizontalSpacing * (0.4 + (rand() % 21) / 100.0));
+        p2.setX(p1.x() + horizontalSpacing * (0.4 + random.bounded(21) / 100.0));
         p2.setY(p1.y());
     }
     bezierPoints << p2;
@@ -215,60 +575,348 @@ QVector<QPoint> PuzzleShapeManager::generateBezierFlowPoints(QPoint p1, QPoint p
 
 
 /**
- * @brief Receives the puzzle preview image and processes it.
+ * @brief Cuts all puzzle shapes out of the image along the generated edges.
+ *
+ * @return True if every shape was cut; false if a tile of the image file could not be read or the cut was canceled.
+ */
+bool PuzzleShapeManager::cutPuzzleShapes()
+{
+    cuttingError.clear();
+
+    QHash<int, QImage> shapeImages;
+    QHash<int, QRect> cuttingRegions;
+    if (settings.useMaskCache)
+    {
+        if (!hasCachedLayout)
+        {
+            PuzzleMaskLayout builtLayout = buildMaskLayout(dividePuzzleIntoShapes());
+            if (isCuttingCanceled())
+            {
+                cuttingError = QString("the cut was canceled");
+                return false;
+            }
+
+            maskLayout = builtLayout;
+            PuzzleMaskCache::instance().insertLayout(maskLayoutKey, maskLayout);
+        }
+
+        shapeImages = applyMaskLayout(maskLayout);
+        cuttingRegions = maskLayout.cuttingRegions;
+    } else
+    {
+        const QHash<int, QPainterPath> puzzleShapes = dividePuzzleIntoShapes();
+        shapeImages = isTiled() ? cutShapesTiled(puzzleShapes, &cuttingError) : cutShapes(puzzleShapes);
+        if (!cuttingError.isEmpty())
+        {
+            pieceImages.clear();
+            pieceRegions.clear();
+            emit puzzleCuttingFailed(cuttingError);
+            return false;
+        }
+
+        for (auto it = puzzleShapes.begin(); it != puzzleShapes.end(); ++it)
+        {
+            cuttingRegions.insert(it.key(), calculateCuttingRegion(it.value()));
+        }
+    }
+
+    if (isCuttingCanceled())
+    {
+        cuttingError = QString("the cut was canceled");
+        return false;
+    }
+
+    pieceImages = shapeImages;
+    pieceRegions = cuttingRegions;
+
+    if (settings.useAtlas)
+    {
+        emit puzzleAtlasReady(PuzzlePieceAtlas::build(pieceImages));
+        return true;
+    }
+
+    emit puzzleShapesReady(pieceImages);
+    return true;
+}
+
+/**
+ * @brief Returns the number of threads used for cutting, resolving 0 to every available core.
+ *
+ * @return The cutting thread count, at least 1.
+ */
+int PuzzleShapeManager::cuttingThreadCount() const
+{
+    if (settings.threadCount > 0)
+    {
+        return settings.threadCount;
+    }
+
+    return qMax(1, QThread::idealThreadCount());
+}
+
+/**
+ * @brief Cuts every puzzle shape out of the image, in parallel when more than one thread is allowed.
+ *
+ * Each shape depends only on its own path and the read-only source image, and every result
+ * is stored under the key of the shape it was cut from, so the output does not depend on the
+ * order in which the worker threads finish.
+ *
+ * @param puzzleShapes The puzzle shapes keyed by shape index.
+ * @return The cut images keyed by the same shape index.
+ */
+QHash<int, QImage> PuzzleShapeManager::cutShapes(const QHash<int, QPainterPath>& puzzleShapes) const
+{
+    if (settings.cuttingEngine == PuzzleGenerationSettings::LabelMap && puzzleShapes.count() <= PuzzleLabelMapCutter::maximumShapeCount())
+    {
+        QHash<int, QRect> cuttingRegions;
+        for (auto it = puzzleShapes.begin(); it != puzzleShapes.end(); ++it)
+        {
+            cuttingRegions.insert(it.key(), calculateCuttingRegion(it.value()));
+        }
+
+        PuzzleLabelMapCutter labelMapCutter(premultipliedImage, settings.flatteningTolerance, cuttingThreadCount());
+        return labelMapCutter.cutShapes(puzzleShapes, cuttingRegions);
+    }
+
+    return mapShapes(puzzleShapes.keys(), [this, &puzzleShapes](int key)
+    {
+        return cutImage(puzzleShapes.value(key));
+    });
+}
+
+/**
+ * @brief Cuts every puzzle shape while reading the source image one tile at a time.
+ *
+ * Shapes are grouped by the tile containing the center of their cutting region, and each group
+ * is cut from a clip of the source covering just the union of its regions. Tiles are read top to
+ * bottom, so sequential decoders only ever move forward through the file.
+ *
+ * @param puzzleShapes The puzzle shapes keyed by shape index.
+ * @param errorString Receives a description of the error if a tile cannot be read.
+ * @return The premultiplied cut images keyed by the same shape index, empty if a tile cannot be read.
+ */
+QHash<int, QImage> PuzzleShapeManager::cutShapesTiled(const QHash<int, QPainterPath>& puzzleShapes, QString *errorString) const
+{
+    int tileSize = qMax(1, settings.tileSize);
+
+    QHash<int, QRect> cuttingRegions;
+    QMap<QPair<int, int>, QList<int>> tiles;
+    for (auto it = puzzleShapes.begin(); it != puzzleShapes.end(); ++it)
+    {
+        QRect cuttingRegion = calculateCuttingRegion(it.value());
+        cuttingRegions.insert(it.key(), cuttingRegion);
+        tiles[qMakePair(cuttingRegion.center().y() / tileSize, cuttingRegion.center().x() / tileSize)].append(it.key());
+    }
+
+    QHash<int, QImage> shapeImages;
+    for (auto tile = tiles.begin(); tile != tiles.end() && !isCuttingCanceled(); ++tile)
+    {
+        QRect tileRect;
+        for (int key : std::as_const(tile.value()))
+        {
+            tileRect = tileRect.united(cuttingRegions.value(key));
+        }
+
+        QImage tileImage = readTile(tileRect, errorString);
+        if (tileImage.isNull())
+        {
+            return QHash<int, QImage>();
+        }
+        QPoint tileOffset = -tileRect.topLeft();
+
+        QHash<int, QImage> tileShapes = mapShapes(tile.value(), [this, &puzzleShapes, &cuttingRegions, &tileImage, tileOffset](int key)
+        {
+            QRect localRegion = cuttingRegions.value(key).translated(tileOffset);
+            QImage mask = drawShapeMask(puzzleShapes.value(key).translated(tileOffset), localRegion);
+            return PuzzleMaskCache::applyMask(tileImage, mask, localRegion);
+        });
+        shapeImages.insert(tileShapes);
+    }
+
+    return shapeImages;
+}
+
+/**
+ * @brief Decodes one rectangle of the source image file.
+ *
+ * @param tileRect The rectangle of the source image to read.
+ * @param errorString Receives a description of the error if the tile cannot be read.
+ * @return The tile in a format MaskApplyKernel reads directly, or a null image if the file cannot be read.
+ */
+QImage PuzzleShapeManager::readTile(const QRect& tileRect, QString *errorString) const
+{
+    QImageReader reader(imageFileName);
+    reader.setClipRect(tileRect);
+    QImage tileImage = reader.read();
+
+    if (tileImage.size() != tileRect.size())
+    {
+        *errorString = QString("cannot read the %1x%2 tile at %3,%4 of %5: %6")
+                           .arg(tileRect.width()).arg(tileRect.height()).arg(tileRect.x()).arg(tileRect.y())
+                           .arg(imageFileName, reader.errorString());
+        return QImage();
+    }
+
+    return MaskApplyKernel::premultipliedSource(tileImage);
+}
+
+/**
+ * @brief Produces one image per shape key, in parallel when more than one thread is allowed.
+ *
+ * Every result is stored under the key it was produced for, so the output does not depend
+ * on the order in which the worker threads finish. Once the cut is canceled the remaining
+ * shapes are skipped and get null images.
+ *
+ * @param shapeKeys The shape keys to process.
+ * @param mapShape Produces the image of one shape, must be safe to call from worker threads.
+ * @return The produced images keyed by shape key.
+ */
+QHash<int, QImage> PuzzleShapeManager::mapShapes(QList<int> shapeKeys, const std::function<QImage(int)>& mapShape) const
+{
+    std::sort(shapeKeys.begin(), shapeKeys.end());
+
+    std::function<QImage(int)> cancelableMapShape = [this, &mapShape](int key)
+    {
+        return isCuttingCanceled() ? QImage() : mapShape(key);
+    };
+
+    QList<QImage> images;
+    int threadCount = cuttingThreadCount();
+
+    if (threadCount == 1)
+    {
+        for (int key : shapeKeys)
+        {
+            images.append(cancelableMapShape(key));
+        }
+    } else
+    {
+        QThreadPool cuttingPool;
+        cuttingPool.setMaxThreadCount(threadCount);
+
+        images = QtConcurrent::blockingMapped<QList<QImage>>(&cuttingPool, shapeKeys, cancelableMapShape);
+    }
+
+    QHash<int, QImage> shapeImages;
+    shapeImages.reserve(shapeKeys.count());
+    for (int i = 0; i < shapeKeys.count(); ++i)
+    {
+        shapeImages.insert(shapeKeys[i], images[i]);
+    }
+
+    return shapeImages;
+}
+
+/**
+ * @brief Rasterizes the alpha mask of a shape over its cutting region.
  *
- * @param puzzlePreview The puzzle preview image.
+ * By default the mask is filled aliased with QPainter, which covers the same pixels as the clip
+ * path the pieces were originally cut with. The scanline rasterizer gives anti-aliased edges
+ * instead and is used when the settings ask for it.
+ *
+ * @param puzzleShape The QPainterPath representing the puzzle shape.
+ * @param cuttingRegion The region of the image covered by the mask.
+ * @return The Format_Alpha8 mask.
  */
-void PuzzleShapeManager::receivePreviewImage(const QImage puzzlePreview)
+QImage PuzzleShapeManager::drawShapeMask(const QPainterPath& puzzleShape, const QRect& cuttingRegion) const
 {
-    MainWindow *mainWindow = qobject_cast<MainWindow*>(parent);
-    if (mainWindow)
+    if (settings.maskRasterizer == PuzzleGenerationSettings::ScanlineMask)
     {
-        mainWindow->receivePuzzlePreview(puzzlePreview);
+        return PuzzleOutlineRasterizer::rasterize(puzzleShape, cuttingRegion, settings.flatteningTolerance);
     }
 
-    QHash<int, QPainterPath> puzzleShapes = dividePuzzleIntoShapes();
+    QImage mask(cuttingRegion.size(), QImage::Format_Alpha8);
+    mask.fill(0);
+
+    QPainter painter(&mask);
+    painter.translate(-cuttingRegion.topLeft());
+    painter.fillPath(puzzleShape, Qt::black);
+    painter.end();
+
+    return mask;
+}
+
+/**
+ * @brief Builds the reusable mask layout of the current puzzle.
+ *
+ * @param puzzleShapes The puzzle shapes keyed by shape index.
+ * @return The layout holding every shape mask, its cutting region and the edges for the preview.
+ */
+PuzzleMaskLayout PuzzleShapeManager::buildMaskLayout(const QHash<int, QPainterPath>& puzzleShapes) const
+{
+    PuzzleMaskLayout layout;
+    layout.edges = puzzleEdgeData->getAllEdges();
 
     for (auto it = puzzleShapes.begin(); it != puzzleShapes.end(); ++it)
     {
-        finalShapes.insert(it.key(), cutImage(it.value()));
+        layout.cuttingRegions.insert(it.key(), calculateCuttingRegion(it.value()));
     }
 
-    mainWindow->receivePuzzleShapes(finalShapes);
+    const QHash<int, QRect> &cuttingRegions = layout.cuttingRegions;
+    layout.masks = mapShapes(puzzleShapes.keys(), [this, &puzzleShapes, &cuttingRegions](int key)
+    {
+        return drawShapeMask(puzzleShapes.value(key), cuttingRegions.value(key));
+    });
+
+    return layout;
+}
+
+/**
+ * @brief Cuts the image with a mask layout, one mask multiply per shape and no path work.
+ *
+ * @param layout The mask layout matching the image size and grid.
+ * @return The premultiplied cut images keyed by shape index.
+ */
+QHash<int, QImage> PuzzleShapeManager::applyMaskLayout(const PuzzleMaskLayout& layout) const
+{
+    return mapShapes(layout.masks.keys(), [this, &layout](int key)
+    {
+        return PuzzleMaskCache::applyMask(premultipliedImage, layout.masks.value(key), layout.cuttingRegions.value(key));
+    });
 }
 
 /**
  * @brief Divides the puzzle into shapes based on its edges.
  *
+ * Shapes are keyed by piece id, the id of their cell in the layout.
+ *
  * @return A hash map containing the puzzle shapes.
  */
 const QHash<int, QPainterPath> PuzzleShapeManager::dividePuzzleIntoShapes()
 {
-    QHash<int, QPainterPath> puzzleShapes = *new QHash<int, QPainterPath>();
-    int count = puzzleEdgeData->count();
+    QHash<int, QPainterPath> puzzleShapes;
+    puzzleShapes.reserve(pieceLayout.cellCount());
 
-    for (int i = 0; i < count; ++i)
+    for (int pieceId = 0; pieceId < pieceLayout.cellCount(); ++pieceId)
     {
-        if((i+1)+(columns+1) < points.count())
-        {
-            if(i%(columns+1) != columns)
-            {
-                QPainterPath shape;
+        puzzleShapes[pieceId] = pieceShape(pieceId);
+    }
 
-                shape = puzzleEdgeData->getEdgeByPoints(points[i],points[i+1]);
-                shape.connectPath(puzzleEdgeData->getEdgeByPoints(points[i+1],points[i+1+(columns+1)]));
-                shape.connectPath((puzzleEdgeData->getEdgeByPoints(points[i+(columns+1)],points[i+1+(columns+1)]).toReversed()));
-                shape.connectPath(puzzleEdgeData->getEdgeByPoints(points[i],points[i+(columns+1)]).toReversed());
+    return puzzleShapes;
+}
 
-                puzzleShapes[i] = shape;
-            }
+/**
+ * @brief Joins the edges around a piece into its outline.
+ *
+ * @param pieceId The id of the piece.
+ * @return The closed outline of the piece in image coordinates.
+ */
+QPainterPath PuzzleShapeManager::pieceShape(int pieceId) const
+{
+    QPainterPath shape;
+    for (const PuzzleLayout::CellEdge &cellEdge : pieceLayout.cell(pieceId).edges)
+    {
+        QPainterPath edgePath = puzzleEdgeData->getEdgePath(cellEdge.edge);
+        if (shape.isEmpty())
+        {
+            shape = cellEdge.reversed ? edgePath.toReversed() : edgePath;
         } else
         {
-            break;
+            shape.connectPath(cellEdge.reversed ? edgePath.toReversed() : edgePath);
         }
     }
 
-    return puzzleShapes;
+    return shape;
 }
 
 /**
@@ -284,40 +932,59 @@ QRect PuzzleShapeManager::calculateCuttingRegion(const QPainterPath& puzzleShape
     int expansion = 4;
     pathBounds.adjust(-expansion, -expansion, expansion, expansion);
 
-    return pathBounds.intersected(myImage.rect());
+    return pathBounds.intersected(QRect(QPoint(0, 0), imageSize));
 }
 
 /**
  * @brief Cuts the image based on the puzzle shape.
  *
+ * Only the piece's own cutting region is allocated and painted, so the cost of a piece
+ * no longer depends on the size of the whole image.
+ *
+ * Safe to call from worker threads, it only reads the source image. In tiled mode only the
+ * cutting region is read from the image file.
+ *
  * @param puzzleShape The QPainterPath representing the puzzle shape.
- * @return The QPixmap representing the cutout image.
+ * @param errorString Receives a description of the error if the cutting region cannot be read, may be null.
+ * @return The QImage representing the cutout image, or a null image if the cutting region cannot be read.
  */
-QPixmap PuzzleShapeManager::cutImage(const QPainterPath& puzzleShape)
+QImage PuzzleShapeManager::cutImage(const QPainterPath& puzzleShape, QString *errorString) const
 {
-    myImageCopy = myImage;
-    QImage cutShape = drawCuttingShape(puzzleShape);
     QRect cuttingRegion = calculateCuttingRegion(puzzleShape);
-    QImage cutoutImage = cutShape.copy(cuttingRegion);
 
-    return QPixmap::fromImage(cutoutImage);
+    if (isTiled())
+    {
+        QString tileError;
+        QImage tileImage = readTile(cuttingRegion, &tileError);
+        if (tileImage.isNull())
+        {
+            if (errorString)
+            {
+                *errorString = tileError;
+            }
+            return QImage();
+        }
+
+        QRect localRegion(QPoint(0, 0), cuttingRegion.size());
+        QImage mask = drawShapeMask(puzzleShape.translated(-cuttingRegion.topLeft()), localRegion);
+        return PuzzleMaskCache::applyMask(tileImage, mask, localRegion);
+    }
+
+    return drawCuttingShape(puzzleShape, cuttingRegion);
 }
 
 /**
- * @brief Draws the cutting shape on a transparent image.
+ * @brief Draws the cutting shape on a transparent image covering only the cutting region.
  *
- * @param puzzleShape The QPainterPath representing the puzzle shape.
- * @return The QImage containing the cutting shape.
+ * The shape is rasterized by drawShapeMask into an 8-bit mask in the same pixel grid a clip path would use,
+ * and the MaskApplyKernel then writes the premultiplied piece pixels straight from the source
+ * scanlines, instead of going through QPainter clip compositing.
+ *
+ * @param puzzleShape The QPainterPath representing the puzzle shape, in image coordinates.
+ * @param cuttingRegion The region of the image covered by the returned shape.
+ * @return The premultiplied QImage containing the cutting shape.
  */
-QImage PuzzleShapeManager::drawCuttingShape(const QPainterPath& puzzleShape)
+QImage PuzzleShapeManager::drawCuttingShape(const QPainterPath& puzzleShape, const QRect& cuttingRegion) const
 {
-    QImage shape(myImage.size(), QImage::Format_ARGB32);
-    shape.fill(Qt::transparent);
-
-    QPainter painter(&shape);
-    painter.setClipPath(puzzleShape);
-    painter.drawImage(QPoint(), myImage);
-    painter.end();
-
-    return shape;
+    return PuzzleMaskCache::applyMask(premultipliedImage, drawShapeMask(puzzleShape, cuttingRegion), cuttingRegion);
 }
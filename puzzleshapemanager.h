@@ -2,48 +2,98 @@
 #define PUZZLESHAPEMANAGER_H
 
 #include "puzzleedgedata.h"
+#include "puzzleedgerandom.h"
+#include "puzzlegenerationsettings.h"
+#include "puzzlelayout.h"
+#include "puzzlemaskcache.h"
+#include "puzzlepieceatlas.h"
+#include <QAtomicInt>
+#include <QFuture>
 #include <QObject>
 #include <QVector>
 #include <QImage>
+#include <functional>
+
+class ImageDividerWithBezier;
 
 class PuzzleShapeManager : public QObject
 {
     Q_OBJECT
 
 public:
-    explicit PuzzleShapeManager(int columns, int rows, const QImage& image, QObject *parent = nullptr);
+    explicit PuzzleShapeManager(int columns, int rows, const QImage& image, const PuzzleGenerationSettings& settings, QObject *parent = nullptr);
+    PuzzleShapeManager(int rows, int columns, const QString& imageFileName, const PuzzleGenerationSettings& settings, QObject *parent = nullptr);
     ~PuzzleShapeManager();
 
-public slots:
-    void saveEdge(const QPair<QPoint, QPoint>& edge, const QPainterPath& path);
-    void receivePreviewImage(const QImage puzzlePreview);
+    static bool requiresTiledGeneration(const QSize& imageSize);
+    static bool supportsTiledGeneration(const QString& imageFileName);
+
+    bool generate();
+    void generateInBackground();
+    void cancelCutting();
+    void deleteWhenIdle();
+    bool regenerateEdge(int edgeId);
+    QImage puzzlePreview() const;
+    const QVector<PuzzleEdge>& puzzleEdges() const;
+    const QHash<int, QImage>& shapeImages() const;
+    const QHash<int, QRect>& shapeRegions() const;
+    const PuzzleLayout& puzzleLayout() const;
+    QPainterPath pieceOutline(int pieceId) const;
+    bool writePiecePack(const QString& fileName, QString *errorString = nullptr) const;
+    QString errorString() const;
 
 private:
     PuzzleEdgeData* puzzleEdgeData;
-    QObject* parent;
-    const QPainterPath loadEdge(const QPair<QPoint, QPoint>& edge) const;
     const QHash<int, QPainterPath> dividePuzzleIntoShapes();
-    QHash<int, QPixmap> finalShapes;
+    QPainterPath pieceShape(int pieceId) const;
+    QHash<int, QImage> pieceImages;
+    QHash<int, QRect> pieceRegions;
 
-    QVector<QPoint> generatePoints();
-    QVector<QPoint> generateBezierFlowPoints(QPoint p1, QPoint p7);
+    QVector<QPoint> generateBezierFlowPoints(QPoint p1, QPoint p7, const QSize& spacing, PuzzleEdgeRandom &random);
     QHash<int, QPainter*> getShapeData();
+    PuzzleEdge createEdge(ImageDividerWithBezier& divider, int edgeId);
 
-    QImage drawCuttingShape(const QPainterPath &shape);
-    QPixmap cutImage(const QPainterPath &shape);
+    QImage drawCuttingShape(const QPainterPath &shape, const QRect &cuttingRegion) const;
+    QImage cutImage(const QPainterPath &shape, QString *errorString = nullptr) const;
+    QHash<int, QImage> cutShapes(const QHash<int, QPainterPath>& puzzleShapes) const;
+    QHash<int, QImage> cutShapesTiled(const QHash<int, QPainterPath>& puzzleShapes, QString *errorString) const;
+    QImage readTile(const QRect& tileRect, QString *errorString) const;
+    QImage createPreviewBase() const;
+    bool isTiled() const;
+    QHash<int, QImage> mapShapes(QList<int> shapeKeys, const std::function<QImage(int)>& mapShape) const;
+    QImage drawShapeMask(const QPainterPath &shape, const QRect &cuttingRegion) const;
+    PuzzleMaskLayout buildMaskLayout(const QHash<int, QPainterPath>& puzzleShapes) const;
+    QHash<int, QImage> applyMaskLayout(const PuzzleMaskLayout& layout) const;
+    void generateEdges();
+    bool cutPuzzleShapes();
+    int cuttingThreadCount() const;
+    bool isCuttingCanceled() const;
     QRect calculateCuttingRegion(const QPainterPath& puzzleShape) const;
     void bezierShapes();
 
-    QVector<QPoint> points;
-    QImage myImage;
-    QImage myImageCopy;
+    PuzzleLayout pieceLayout;
+    QImage premultipliedImage;
+    QString imageFileName;
+    QSize imageSize;
+    PuzzleGenerationSettings settings;
+    PuzzleMaskLayoutKey maskLayoutKey;
+    PuzzleMaskLayout maskLayout;
+    bool hasCachedLayout;
+    QFuture<void> cuttingFuture;
+    QAtomicInt cuttingCanceled;
+    QString cuttingError;
+    QHash<int, quint32> edgeRerolls;
     int userShapes;
     int rows;
     int columns;
-    int horizontalSpacing;
-    int verticalSpacing;
 
 signals:
+    void puzzleEdgesReady(const QVector<PuzzleEdge> edges);
+    void puzzleShapesReady(const QHash<int, QImage> shapes);
+    void puzzleAtlasReady(const QSharedPointer<PuzzlePieceAtlas> atlas);
+    void puzzleCuttingFailed(const QString errorString);
+    void puzzleEdgeChanged(int edgeId, const PuzzleEdge edge);
+    void puzzlePiecesChanged(const QHash<int, QImage> pieces);
 };
 
 #endif // PUZZLESHAPEMANAGER_H
@@ -0,0 +1,149 @@
+#include "puzzlespatialindex.h"
+#include <algorithm>
+
+/**
+ * @class PuzzleSpatialIndex
+ * @brief A uniform grid of buckets for finding items by position.
+ *
+ * Every item is stored in the buckets its bounding rectangle overlaps. With buckets about the
+ * size of an item, inserting, removing and querying a point touch a constant number of buckets,
+ * no matter how many items there are. Rectangles reaching outside the indexed area are clamped
+ * to the border buckets.
+ */
+
+
+/**
+ * @brief Creates an empty index.
+ *
+ * @param area The area covered by the buckets.
+ * @param bucketSize The edge length of a bucket, best about the size of an item.
+ */
+PuzzleSpatialIndex::PuzzleSpatialIndex(const QRect& area, int bucketSize)
+    : area(area)
+    , bucketSize(qMax(1, bucketSize))
+{
+    bucketColumns = qMax(1, (area.width() + this->bucketSize - 1) / this->bucketSize);
+    bucketRows = qMax(1, (area.height() + this->bucketSize - 1) / this->bucketSize);
+    buckets.resize(bucketColumns * bucketRows);
+}
+
+/**
+ * @brief Adds an item.
+ *
+ * @param id The id of the item.
+ * @param bounds The bounding rectangle of the item.
+ */
+void PuzzleSpatialIndex::insert(int id, const QRect& bounds)
+{
+    QRect range = bucketRange(bounds);
+    for (int row = range.top(); row <= range.bottom(); ++row)
+    {
+        for (int column = range.left(); column <= range.right(); ++column)
+        {
+            buckets[row * bucketColumns + column].append(id);
+        }
+    }
+}
+
+/**
+ * @brief Removes an item.
+ *
+ * @param id The id of the item.
+ * @param bounds The bounding rectangle the item was inserted with.
+ */
+void PuzzleSpatialIndex::remove(int id, const QRect& bounds)
+{
+    QRect range = bucketRange(bounds);
+    for (int row = range.top(); row <= range.bottom(); ++row)
+    {
+        for (int column = range.left(); column <= range.right(); ++column)
+        {
+            QVector<int> &bucket = buckets[row * bucketColumns + column];
+            int index = bucket.indexOf(id);
+            if (index >= 0)
+            {
+                bucket.swapItemsAt(index, bucket.count() - 1);
+                bucket.removeLast();
+            }
+        }
+    }
+}
+
+/**
+ * @brief Removes all items.
+ */
+void PuzzleSpatialIndex::clear()
+{
+    for (QVector<int> &bucket : buckets)
+    {
+        bucket.clear();
+    }
+}
+
+/**
+ * @brief Returns the items whose bounding rectangle may contain a point.
+ *
+ * @param point The point.
+ * @return The ids stored in the bucket of the point.
+ */
+QVector<int> PuzzleSpatialIndex::query(const QPoint& point) const
+{
+    if (buckets.isEmpty())
+    {
+        return QVector<int>();
+    }
+
+    QRect range = bucketRange(QRect(point, QSize(1, 1)));
+    return buckets[range.top() * bucketColumns + range.left()];
+}
+
+/**
+ * @brief Returns the items whose bounding rectangle may overlap a rectangle.
+ *
+ * @param rect The rectangle.
+ * @return The ids stored in the buckets overlapping the rectangle, each id once, in ascending order.
+ */
+QVector<int> PuzzleSpatialIndex::query(const QRect& rect) const
+{
+    QVector<int> ids;
+    if (buckets.isEmpty())
+    {
+        return ids;
+    }
+
+    QRect range = bucketRange(rect);
+    for (int row = range.top(); row <= range.bottom(); ++row)
+    {
+        for (int column = range.left(); column <= range.right(); ++column)
+        {
+            ids.append(buckets[row * bucketColumns + column]);
+        }
+    }
+
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    return ids;
+}
+
+/**
+ * @brief Returns the buckets a rectangle overlaps.
+ *
+ * @param rect The rectangle.
+ * @return The bucket columns and rows covered, clamped to the index.
+ */
+QRect PuzzleSpatialIndex::bucketRange(const QRect& rect) const
+{
+    auto bucketOf = [this](int position, int origin, int count)
+    {
+        int bucket = position >= origin ? (position - origin) / bucketSize : -1;
+        return qBound(0, bucket, count - 1);
+    };
+
+    QRect normalized = rect.normalized();
+    int left = bucketOf(normalized.left(), area.left(), bucketColumns);
+    int right = bucketOf(normalized.right(), area.left(), bucketColumns);
+    int top = bucketOf(normalized.top(), area.top(), bucketRows);
+    int bottom = bucketOf(normalized.bottom(), area.top(), bucketRows);
+
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
@@ -0,0 +1,31 @@
+#ifndef PUZZLESPATIALINDEX_H
+#define PUZZLESPATIALINDEX_H
+
+#include <QPoint>
+#include <QRect>
+#include <QVector>
+
+class PuzzleSpatialIndex
+{
+public:
+    PuzzleSpatialIndex() = default;
+    PuzzleSpatialIndex(const QRect& area, int bucketSize);
+
+    void insert(int id, const QRect& bounds);
+    void remove(int id, const QRect& bounds);
+    void clear();
+
+    QVector<int> query(const QPoint& point) const;
+    QVector<int> query(const QRect& rect) const;
+
+private:
+    QRect bucketRange(const QRect& rect) const;
+
+    QRect area;
+    int bucketSize = 1;
+    int bucketColumns = 0;
+    int bucketRows = 0;
+    QVector<QVector<int>> buckets;
+};
+
+#endif // PUZZLESPATIALINDEX_H
@@ -0,0 +1,211 @@
+#include "puzzlethumbnailcache.h"
+#include <QtConcurrent>
+
+/**
+ * @class PuzzleThumbnailCache
+ * @brief Keeps a chain of half size copies of every piece, for drawing pieces smaller than they are.
+ *
+ * Level 0 is the half size copy, every further level halves the previous one with a 2x2 box filter
+ * on premultiplied pixels, down to a few pixels. The chains are built once per puzzle on worker
+ * threads, views then ask for the smallest level that still covers the size they draw at, so only
+ * a level less than twice the drawn size is ever scaled. Pixmaps of the levels are created on the
+ * GUI thread when they are first drawn. Until the chains are ready, and for sizes bigger than half
+ * a piece, thumbnail() returns a null pixmap and the full piece is drawn.
+ */
+
+
+/**
+ * @brief Creates an empty cache.
+ *
+ * @param parent The parent object.
+ */
+PuzzleThumbnailCache::PuzzleThumbnailCache(QObject *parent)
+    : QObject(parent)
+    , ready(false)
+{
+    connect(&buildWatcher, &QFutureWatcher<QHash<int, QVector<QImage>>>::finished, this, &PuzzleThumbnailCache::finishBuild);
+}
+
+PuzzleThumbnailCache::~PuzzleThumbnailCache()
+{
+    buildWatcher.waitForFinished();
+}
+
+/**
+ * @brief Scales an image to half its size, averaging each 2x2 block.
+ *
+ * Odd widths and heights repeat the last column or row.
+ *
+ * @param image The image.
+ * @return The half size image in Format_ARGB32_Premultiplied.
+ */
+QImage PuzzleThumbnailCache::halfSize(const QImage& image)
+{
+    QImage source = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    QImage result((source.width() + 1) / 2, (source.height() + 1) / 2, QImage::Format_ARGB32_Premultiplied);
+
+    for (int y = 0; y < result.height(); ++y)
+    {
+        const QRgb *firstLine = reinterpret_cast<const QRgb*>(source.constScanLine(2 * y));
+        const QRgb *secondLine = reinterpret_cast<const QRgb*>(source.constScanLine(qMin(2 * y + 1, source.height() - 1)));
+        QRgb *resultLine = reinterpret_cast<QRgb*>(result.scanLine(y));
+
+        for (int x = 0; x < result.width(); ++x)
+        {
+            int left = 2 * x;
+            int right = qMin(left + 1, source.width() - 1);
+            QRgb pixels[4] = {firstLine[left], firstLine[right], secondLine[left], secondLine[right]};
+
+            int alpha = 2;
+            int red = 2;
+            int green = 2;
+            int blue = 2;
+            for (QRgb pixel : pixels)
+            {
+                alpha += qAlpha(pixel);
+                red += qRed(pixel);
+                green += qGreen(pixel);
+                blue += qBlue(pixel);
+            }
+            resultLine[x] = qRgba(red >> 2, green >> 2, blue >> 2, alpha >> 2);
+        }
+    }
+
+    return result;
+}
+
+/**
+ * @brief Builds the chain of half size copies of a piece.
+ *
+ * Safe to call from any thread.
+ *
+ * @param image The piece image.
+ * @return The levels, from half size down to the smallest one.
+ */
+QVector<QImage> PuzzleThumbnailCache::buildLevels(const QImage& image)
+{
+    QVector<QImage> chain;
+    QImage level = image;
+    while (qMax(level.width(), level.height()) >= 2 * minimumLevelSize)
+    {
+        level = halfSize(level);
+        chain.append(level);
+    }
+
+    return chain;
+}
+
+/**
+ * @brief Builds the levels of all pieces on a worker thread, replacing the current ones.
+ *
+ * Emits thumbnailsReady() when done.
+ *
+ * @param pieces The piece images keyed by piece id.
+ */
+void PuzzleThumbnailCache::build(const QHash<int, QImage>& pieces)
+{
+    buildWatcher.waitForFinished();
+    ready = false;
+    levels.clear();
+    pixmaps.clear();
+
+    buildWatcher.setFuture(QtConcurrent::mappedReduced<QHash<int, QVector<QImage>>>(pieces.keys(),
+        [pieces](int pieceId)
+        {
+            return qMakePair(pieceId, buildLevels(pieces.value(pieceId)));
+        },
+        [](QHash<int, QVector<QImage>> &result, const QPair<int, QVector<QImage>> &chain)
+        {
+            result.insert(chain.first, chain.second);
+        }));
+}
+
+/**
+ * @brief Builds the levels of a piece that was cut again.
+ *
+ * @param pieceId The piece id.
+ * @param image The new piece image.
+ */
+void PuzzleThumbnailCache::replacePiece(int pieceId, const QImage& image)
+{
+    buildWatcher.waitForFinished();
+    if (!ready && buildWatcher.future().isValid())
+    {
+        finishBuild();
+    }
+
+    QVector<QImage> chain = buildLevels(image);
+    for (int level = 0; level < qMax(chain.count(), levels.value(pieceId).count()); ++level)
+    {
+        pixmaps.remove(qMakePair(pieceId, level));
+    }
+    levels.insert(pieceId, chain);
+}
+
+/**
+ * @brief Checks whether the levels are built.
+ *
+ * @return True once the worker thread finished; otherwise, false.
+ */
+bool PuzzleThumbnailCache::isReady() const
+{
+    return ready;
+}
+
+/**
+ * @brief Returns the smallest level of a piece that covers a size.
+ *
+ * Must be called on the GUI thread.
+ *
+ * @param pieceId The piece id.
+ * @param size The size the piece is drawn at.
+ * @return The level pixmap, or a null pixmap if the full piece has to be drawn.
+ */
+QPixmap PuzzleThumbnailCache::thumbnail(int pieceId, const QSize& size) const
+{
+    auto chain = levels.constFind(pieceId);
+    if (!ready || chain == levels.constEnd())
+    {
+        return QPixmap();
+    }
+
+    int level = -1;
+    while (level + 1 < chain->count()
+           && chain->at(level + 1).width() >= size.width() && chain->at(level + 1).height() >= size.height())
+    {
+        ++level;
+    }
+
+    if (level < 0)
+    {
+        return QPixmap();
+    }
+
+    QPair<int, int> key(pieceId, level);
+    auto cached = pixmaps.constFind(key);
+    if (cached != pixmaps.constEnd())
+    {
+        return cached.value();
+    }
+
+    QPixmap pixmap = QPixmap::fromImage(chain->at(level));
+    pixmaps.insert(key, pixmap);
+    return pixmap;
+}
+
+/**
+ * @brief Takes over the levels built on the worker threads.
+ *
+ * Does nothing if the levels were already taken over.
+ */
+void PuzzleThumbnailCache::finishBuild()
+{
+    if (ready)
+    {
+        return;
+    }
+
+    levels = buildWatcher.result();
+    ready = true;
+    emit thumbnailsReady();
+}
@@ -0,0 +1,42 @@
+#ifndef PUZZLETHUMBNAILCACHE_H
+#define PUZZLETHUMBNAILCACHE_H
+
+#include <QFutureWatcher>
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QPixmap>
+#include <QVector>
+
+class PuzzleThumbnailCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PuzzleThumbnailCache(QObject *parent = nullptr);
+    ~PuzzleThumbnailCache();
+
+    static QImage halfSize(const QImage& image);
+    static QVector<QImage> buildLevels(const QImage& image);
+
+    void build(const QHash<int, QImage>& pieces);
+    void replacePiece(int pieceId, const QImage& image);
+    bool isReady() const;
+    QPixmap thumbnail(int pieceId, const QSize& size) const;
+
+signals:
+    void thumbnailsReady();
+
+private slots:
+    void finishBuild();
+
+private:
+    static constexpr int minimumLevelSize = 16;
+
+    QFutureWatcher<QHash<int, QVector<QImage>>> buildWatcher;
+    QHash<int, QVector<QImage>> levels;
+    mutable QHash<QPair<int, int>, QPixmap> pixmaps;
+    bool ready;
+};
+
+#endif // PUZZLETHUMBNAILCACHE_H